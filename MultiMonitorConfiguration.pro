@@ -19,6 +19,9 @@ SOURCES += main.cpp\
         mainwindow.cpp
 
 HEADERS  += mainwindow.h \
-    screenconfiglayout.h
+    screenconfiglayout.h \
+    layoutserializer.h \
+    bordersampling.h \
+    screensnapshot.h
 
 FORMS    += mainwindow.ui
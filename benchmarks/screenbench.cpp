@@ -0,0 +1,795 @@
+#include <QtTest>
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+
+#include "screenconfiglayout.h"
+#include "layoutserializer.h"
+#include "bordersampling.h"
+#include "screensnapshot.h"
+
+using namespace ScreenConfigWidget;
+
+namespace {
+
+const int TILE_WIDTH = 1920;///< width of the synthetic monitors
+const int TILE_HEIGHT = 1080;///< height of the synthetic monitors
+const int POINTS = 1000;///< points tested per benchmark iteration
+const int MAX_IMAGE_SIZE = 2048;///< drawing benchmarks scale the layout down to fit this many pixels
+
+/// \brief Add count monitors in a grid of about square shape
+void fillGrid(Screen& screen, int count) {
+    const int columns = int(std::ceil(std::sqrt(double(count))));
+    screen.reserve(count);
+    for(int i = 0; i < count; i++)
+        screen.addMonitor(QString::number(i), TILE_WIDTH, TILE_HEIGHT, (i % columns) * TILE_WIDTH, (i / columns) * TILE_HEIGHT);
+}
+
+/// \brief Scaled layout area, as the widget would show it with auto-fit
+QRect scaledLayout(const Screen& screen) {
+    const QRect bounds = screen.layoutBounds();
+    return QRect(QPoint(bounds.topLeft() * screen.scale()), QPoint(bounds.bottomRight() * screen.scale()));
+}
+
+/// \brief The same pseudo random scaled points within the layout on every run
+QVector<QPoint> samplePoints(const Screen& screen, int count = POINTS) {
+    const QRect area = scaledLayout(screen);
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> x(area.left(), area.right());
+    std::uniform_int_distribution<int> y(area.top(), area.bottom());
+
+    QVector<QPoint> points;
+    points.reserve(count);
+    for(int i = 0; i < count; i++)
+        points.push_back(QPoint(x(random), y(random)));
+    return points;
+}
+
+/// \brief Compare everything the layout files store
+bool sameLayout(const Screen& a, const Screen& b) {
+    if(a.monitors().size() != b.monitors().size())
+        return false;
+
+    for(size_t i = 0; i < a.monitors().size(); i++) {
+        const Monitor& m = a.monitors()[i];
+        const Monitor& n = b.monitors()[i];
+        if(m.getName() != n.getName() || m.width() != n.width() || m.height() != n.height() || m.xOffset() != n.xOffset()
+                || m.yOffset() != n.yOffset() || m.verticalLetterboxBarWidth() != n.verticalLetterboxBarWidth()
+                || m.horizontalLetterboxBarHeight() != n.horizontalLetterboxBarHeight())
+            return false;
+        for(int border = 0; border < 4; border++)
+            if(m[border].drawColor != n[border].drawColor)
+                return false;
+    }
+
+    for(int i = 0; i < 4; i++) {
+        const QVector<BorderHandle>& selected = a.selectedBorders(BorderIndex(i));
+        const QVector<BorderHandle>& loaded = b.selectedBorders(BorderIndex(i));
+        if(selected.size() != loaded.size())
+            return false;
+        for(int s = 0; s < selected.size(); s++)
+            if(a.monitor(selected.at(s).monitor)->getName() != b.monitor(loaded.at(s).monitor)->getName())
+                return false;
+    }
+    return true;
+}
+
+/// \brief The names of the first two monitors whose bounding rectangles overlap, or an empty string
+QString firstOverlap(const Screen& screen) {
+    const std::vector<Monitor>& monitors = screen.monitors();
+    for(size_t i = 0; i < monitors.size(); i++)
+        for(size_t j = i + 1; j < monitors.size(); j++)
+            if(monitors[i].boundingRectangle().intersects(monitors[j].boundingRectangle()))
+                return monitors[i].getName() + " / " + monitors[j].getName();
+    return QString();
+}
+
+/// \brief The border lookup as it was before the hit grid and the packed border table: every monitor, every border
+const Border* legacyGetBorder(const Screen& screen, const QPoint& pos, QString& monitor, int& border) {
+    monitor = "";
+    border = -1;
+    for(const Monitor& m : screen.monitors()) {
+        if(m.boundingRectangle(screen.scale()).contains(pos)) {
+            for(int i = 0; i < 4; i++) {
+                if(m[i].qRect(screen.scale()).contains(pos)) {
+                    monitor = m.getName();
+                    border = i;
+                    return &m[i];
+                }
+            }
+        }
+    }
+    return nullptr;
+}
+
+/// \brief Entry e of a BorderHitTable, kept alongside it as reference
+struct HitRect {
+    int left, top, right, bottom;
+
+    bool contains(const QPoint& pos) const {
+        return left <= pos.x() && pos.x() <= right && top <= pos.y() && pos.y() <= bottom;
+    }
+};
+
+/// \brief BorderHitTable::find() as a plain loop
+int referenceFind(const QVector<HitRect>& rects, const QPoint& pos) {
+    for(int e = 0; e < rects.size(); e++)
+        if(rects.at(e).contains(pos))
+            return e;
+    return -1;
+}
+
+/// \brief BorderHitTable::findInSlot() as a plain loop
+int referenceFindInSlot(const QVector<HitRect>& rects, int slot, const QPoint& pos) {
+    for(int i = 0; i < 4; i++)
+        if(rects.at(slot * 4 + i).contains(pos))
+            return i;
+    return -1;
+}
+
+/// \brief Mean color of the pixels of area on the subsampling grid, one pixel at a time
+QRgb referenceMean(const FrameView& frame, const QRect& area, int subsample) {
+    ColorSum sum;
+    const QRect clipped = area & frame.area;
+    for(int y = clipped.top(); y <= clipped.bottom(); y++) {
+        for(int x = clipped.left(); x <= clipped.right(); x++) {
+            // the grid is anchored at desktop 0, also for negative coordinates
+            if(((y % subsample) + subsample) % subsample != 0 || ((x % subsample) + subsample) % subsample != 0)
+                continue;
+            const uchar* pixel = frame.pixels + (y - frame.area.top()) * frame.stride + 4 * (x - frame.area.left());
+            for(int c = 0; c < 4; c++)
+                sum.channels[c] += pixel[c];
+            sum.pixels++;
+        }
+    }
+    return sum.mean();
+}
+
+/// \brief The snapshot copies of the selected borders match its monitors, and the monitors "0" and "1" are one tile apart
+bool consistentSnapshot(const ScreenSnapshot& snapshot) {
+    const MonitorSnapshot* first = nullptr;
+    const MonitorSnapshot* second = nullptr;
+    for(const MonitorSnapshot& m : snapshot.monitors) {
+        if(m.name == "0")
+            first = &m;
+        else if(m.name == "1")
+            second = &m;
+    }
+    if(!first || !second || second->geometry.xOffset - first->geometry.xOffset != TILE_WIDTH)
+        return false;
+
+    for(int i = 0; i < 4; i++) {
+        if(snapshot.selectedHandles[i].size() != snapshot.selectedBorders[i].size())
+            return false;
+        for(size_t s = 0; s < snapshot.selectedHandles[i].size(); s++) {
+            const BorderHandle& handle = snapshot.selectedHandles[i][s];
+            const Border& copy = snapshot.selectedBorders[i][s];
+            const auto owner = std::find_if(snapshot.monitors.begin(), snapshot.monitors.end(), [&handle](const MonitorSnapshot& m) {
+                return m.id == handle.monitor;
+            });
+            if(owner == snapshot.monitors.end())
+                return false;
+            const Border& border = owner->borders[int(handle.border)];
+            if(border.drawColor != copy.drawColor || border.geometry.xOffset != copy.geometry.xOffset
+                    || border.geometry.yOffset != copy.geometry.yOffset || border.geometry.width != copy.geometry.width)
+                return false;
+        }
+    }
+    return true;
+}
+
+/// \brief Rows for 4 to 4096 monitors
+void monitorCountRows() {
+    QTest::addColumn<int>("monitors");
+    for(int count = 4; count <= 4096; count *= 4)
+        QTest::newRow(qPrintable(QString::number(count))) << count;
+}
+
+}
+
+/**
+ * @brief Benchmarks of Screen without a display, to catch regressions before rolling out a build
+ */
+class ScreenBench : public QObject {
+    Q_OBJECT
+
+private slots:
+    void addMonitor_data() {
+        monitorCountRows();
+    }
+
+    /// \brief Build the whole grid
+    void addMonitor() {
+        QFETCH(int, monitors);
+        QBENCHMARK {
+            Screen screen;
+            fillGrid(screen, monitors);
+        }
+    }
+
+    void getMonitorAtPoint_data() {
+        monitorCountRows();
+    }
+
+    /// \brief POINTS monitor lookups at scaled positions, as on every click
+    void getMonitorAtPoint() {
+        QFETCH(int, monitors);
+        Screen screen;
+        fillGrid(screen, monitors);
+        const QVector<QPoint> points = samplePoints(screen);
+
+        int hits = 0;
+        QBENCHMARK {
+            for(const QPoint& p : points)
+                hits += screen.getMonitor(p) != nullptr;
+        }
+        QVERIFY(hits > 0);
+    }
+
+    void getBorder_data() {
+        monitorCountRows();
+    }
+
+    /// \brief POINTS border lookups at scaled positions, as on every click in border selection mode
+    void getBorder() {
+        QFETCH(int, monitors);
+        Screen screen;
+        fillGrid(screen, monitors);
+        const QVector<QPoint> points = samplePoints(screen);
+
+        QString monitor;
+        int border = -1;
+        QBENCHMARK {
+            for(const QPoint& p : points)
+                screen.getBorder(p, monitor, border);
+        }
+    }
+
+    void getBorderKernel_data() {
+        QTest::addColumn<int>("monitors");
+        QTest::addColumn<QString>("kernel");
+        for(int count : {10, 100, 1000})
+            for(const char* kernel : {"legacy", "borderAt", "bordersAt"})
+                QTest::newRow(qPrintable(QString("%1 %2").arg(kernel).arg(count))) << count << QString(kernel);
+    }
+
+    /// \brief POINTS border lookups with the old loop over all monitors, the hit grid and the batched table scan
+    void getBorderKernel() {
+        QFETCH(int, monitors);
+        QFETCH(QString, kernel);
+        Screen screen;
+        fillGrid(screen, monitors);
+        const QVector<QPoint> points = samplePoints(screen);
+
+        // all three find the same borders, the grid layout has no overlaps
+        QVector<BorderHandle> batch(points.size());
+        screen.bordersAt(points.constData(), points.size(), batch.data());
+        for(int i = 0; i < points.size(); i++) {
+            QString monitor;
+            int border = -1;
+            legacyGetBorder(screen, points.at(i), monitor, border);
+            const BorderHandle handle = screen.borderAt(points.at(i));
+            QCOMPARE(handle, batch.at(i));
+            QCOMPARE(handle.isValid() ? screen.monitor(handle.monitor)->getName() : QString(), monitor);
+            QCOMPARE(handle.isValid() ? int(handle.border) : -1, border);
+        }
+
+        if(kernel == "legacy") {
+            QString monitor;
+            int border = -1;
+            QBENCHMARK {
+                for(const QPoint& p : points)
+                    legacyGetBorder(screen, p, monitor, border);
+            }
+        } else if(kernel == "borderAt") {
+            QBENCHMARK {
+                for(const QPoint& p : points)
+                    screen.borderAt(p);
+            }
+        } else {
+            QBENCHMARK {
+                screen.bordersAt(points.constData(), points.size(), batch.data());
+            }
+        }
+    }
+
+    /// \brief BorderHitTable::find() and findInSlot() agree with plain loops, for whichever of AVX2, SSE2 and scalar code is built
+    void borderHitTableMatchesReference() {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> coordinate(-64, 64);
+        std::uniform_int_distribution<int> extent(-2, 24);
+
+        BorderHitTable table;
+        QVector<HitRect> rects;
+        // odd slot counts leave padding in the last vector, removals shift later slots
+        for(int slot = 0; slot < 37; slot++) {
+            table.appendSlot();
+            for(int i = 0; i < 4; i++) {
+                // negative extents give empty rectangles, as for clipped borders
+                const int left = coordinate(random), top = coordinate(random);
+                const HitRect rect = {left, top, left + extent(random), top + extent(random)};
+                table.setRect(slot, BorderIndex(i), QRect(QPoint(rect.left, rect.top), QPoint(rect.right, rect.bottom)));
+                rects.push_back(rect);
+            }
+        }
+        for(int slot : {36, 20, 0}) {
+            table.removeSlot(slot);
+            rects.remove(slot * 4, 4);
+        }
+        QCOMPARE(table.entryCount(), rects.size());
+
+        std::uniform_int_distribution<int> point(-96, 96);
+        for(int i = 0; i < 200000; i++) {
+            const QPoint pos(point(random), point(random));
+            QCOMPARE(table.find(pos), referenceFind(rects, pos));
+            const int slot = i % (rects.size() / 4);
+            QCOMPARE(table.findInSlot(slot, pos), referenceFindInSlot(rects, slot, pos));
+        }
+    }
+
+    /// \brief FixedScale::apply() rounds like qRound() applied to the quantized factor, including negative halves
+    void fixedScaleMatchesQRound() {
+        QCOMPARE(FixedScale(0.5).apply(5), Coordinate(3));
+        QCOMPARE(FixedScale(0.5).apply(-5), Coordinate(-2));
+        QCOMPARE(FixedScale(0.5).apply(-3), Coordinate(-1));
+        QCOMPARE(FixedScale(0.001).fixed, qint64(16777));
+
+        // below 2^21 pixels the products are exact in a double, so qRound sees the same value
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> coordinate(-(1 << 21), 1 << 21);
+        for(double factor : {1.0 / 1000.0, 1.0 / 10.0, 1.0 / 3.0, 0.5, 1.0, 2.5, 64.0}) {
+            const FixedScale scale(factor);
+            const double quantized = double(scale.fixed) / FixedScale::ONE;
+            for(int i = 0; i < 100000; i++) {
+                const int v = coordinate(random);
+                QCOMPARE(scale.apply(v), Coordinate(qRound(v * quantized)));
+            }
+        }
+    }
+
+    /// \brief SamplingMap::accumulateRow() adds up the same channels as a plain loop, for whichever of AVX2, SSE2 and scalar code is built
+    void accumulateRowMatchesReference() {
+        // saturated pixels overflow the 16 bit partial sums soonest
+        std::vector<uchar> row(4 * 3000, 255);
+        std::mt19937 random(1);
+        for(size_t i = 4 * 2000; i < row.size(); i++)
+            row[i] = uchar(random());
+
+        for(int first : {0, 1, 3, 1000, 1500}) {
+            for(int count : {0, 1, 3, 4, 7, 8, 9, 511, 1024, 1025, 1500}) {
+                ColorSum vector;
+                SamplingMap::accumulateRow(row.data() + 4 * first, count, vector);
+                ColorSum plain;
+                for(int i = first; i < first + count; i++)
+                    for(int c = 0; c < 4; c++)
+                        plain.channels[c] += row[size_t(4 * i + c)];
+
+                for(int c = 0; c < 4; c++)
+                    QCOMPARE(vector.channels[c], plain.channels[c]);
+                QCOMPARE(vector.pixels, quint64(count));
+            }
+        }
+    }
+
+    /// \brief SamplingMap::sample() and ParallelSampler::sample() give every LED the mean of its pixels, as a per pixel loop does
+    void samplingMatchesPerPixelReference() {
+        Screen screen;
+        fillGrid(screen, 6);
+        screen.addMonitor("left panel", 1280, 1024, -1280, 0, 20, 10);
+        for(const char* name : {"left panel", "0", "1"})
+            screen.toggleBorderSelection(BorderHandle(screen.monitorId(name), BorderIndex::TOP), Qt::red);
+        screen.toggleBorderSelection(BorderHandle(screen.monitorId("left panel"), BorderIndex::LEFT), Qt::red);
+        screen.toggleBorderSelection(BorderHandle(screen.monitorId("5"), BorderIndex::RIGHT), Qt::red);
+        screen.toggleBorderSelection(BorderHandle(screen.monitorId("3"), BorderIndex::BOTTOM), Qt::red);
+
+        SamplingMap map;
+        const int ledsPerSide[4] = {7, 5, 31, 9};
+        map.compile(screen, ledsPerSide);
+        QCOMPARE(map.ledCount(), 7 + 5 + 31 + 9);
+
+        // a frame not quite covering the layout, with padded rows and a negative origin
+        FrameView frame;
+        frame.area = map.bounds().adjusted(7, 3, -5, -2);
+        frame.stride = 4 * frame.area.width() + 12;
+        std::vector<uchar> pixels(size_t(frame.stride) * size_t(frame.area.height()));
+        std::mt19937 random(1);
+        for(uchar& byte : pixels)
+            byte = uchar(random());
+        frame.pixels = pixels.data();
+
+        ParallelSampler sampler(4);
+        for(int subsample : {1, 2, 3, 8}) {
+            QVector<QRgb> colors;
+            map.sample(frame, colors, subsample);
+            QVector<QRgb> parallel;
+            sampler.sample(map, frame, parallel, subsample);
+
+            QCOMPARE(colors.size(), map.ledCount());
+            QCOMPARE(parallel, colors);
+            for(int led = 0; led < map.ledCount(); led++)
+                QCOMPARE(colors.at(led), referenceMean(frame, map.ledArea(led), subsample));
+        }
+    }
+
+    /// \brief SamplingMap compiles a ScreenSnapshot to the same LEDs and spans as the Screen it was taken of
+    void samplingMapCompilesSnapshot() {
+        Screen screen;
+        fillGrid(screen, 6);
+        screen.addMonitor("left panel", 1280, 1024, -1280, 0, 20, 10);
+        for(const char* name : {"1", "left panel", "0"})
+            screen.toggleBorderSelection(BorderHandle(screen.monitorId(name), BorderIndex::TOP), Qt::red);
+        screen.toggleBorderSelection(BorderHandle(screen.monitorId("left panel"), BorderIndex::LEFT), Qt::red);
+        screen.toggleBorderSelection(BorderHandle(screen.monitorId("5"), BorderIndex::RIGHT), Qt::red);
+        screen.toggleBorderSelection(BorderHandle(screen.monitorId("3"), BorderIndex::BOTTOM), Qt::red);
+        const ScreenSnapshot snapshot(screen);
+
+        const int ledsPerSide[4] = {7, 5, 31, 9};
+        SamplingMap fromScreen, fromSnapshot;
+        for(bool borders : {false, true}) {
+            if(borders) {
+                fromScreen.compileBorders(screen);
+                fromSnapshot.compileBorders(snapshot);
+            } else {
+                fromScreen.compile(screen, ledsPerSide);
+                fromSnapshot.compile(snapshot, ledsPerSide);
+            }
+
+            QCOMPARE(fromSnapshot.ledCount(), fromScreen.ledCount());
+            QCOMPARE(fromSnapshot.bounds(), fromScreen.bounds());
+            for(int led = 0; led < fromScreen.ledCount(); led++) {
+                QCOMPARE(fromSnapshot.ledArea(led), fromScreen.ledArea(led));
+                QCOMPARE(fromSnapshot.ledBorder(led), fromScreen.ledBorder(led));
+            }
+            QCOMPARE(fromSnapshot.spans().size(), fromScreen.spans().size());
+            for(int s = 0; s < fromScreen.spans().size(); s++) {
+                const SamplingSpan& a = fromSnapshot.spans().at(s);
+                const SamplingSpan& b = fromScreen.spans().at(s);
+                QVERIFY(a.x == b.x && a.y == b.y && a.length == b.length && a.led == b.led);
+            }
+        }
+    }
+
+    /// \brief Readers on worker threads only ever see whole snapshots while the GUI thread keeps publishing; run a tsan build to check the reclamation
+    void snapshotPublisherStress() {
+        const int readerCount = 4;
+        const int steps = 20000;
+
+        Screen screen;
+        fillGrid(screen, 16);
+        Monitor* first = screen.monitor(screen.monitorId("0"));
+        Monitor* second = screen.monitor(screen.monitorId("1"));
+        screen.toggleBorderSelection(BorderHandle(first->id(), BorderIndex::TOP), Qt::red);
+        screen.toggleBorderSelection(BorderHandle(second->id(), BorderIndex::TOP), Qt::red);
+
+        SnapshotPublisher publisher;
+        publisher.publish(screen);
+
+        std::atomic<bool> done{false};
+        std::atomic<int> torn{0};
+        std::atomic<int> reads{0};
+        std::vector<std::thread> readers;
+        for(int r = 0; r < readerCount; r++) {
+            readers.emplace_back([&]() {
+                SnapshotReader reader(publisher);
+                quint64 version = 0;
+                while(!done.load()) {
+                    const ScreenSnapshot* snapshot = reader.acquire();
+                    if(!consistentSnapshot(*snapshot) || snapshot->version < version)
+                        torn++;
+                    version = snapshot->version;
+                    reads++;
+                }
+            });
+        }
+
+        // every step changes two monitors and sometimes a selection, published at once
+        int published = 0;
+        for(int step = 1; step <= steps; step++) {
+            first->apply(GeometryUpdate().setXOffset(step));
+            second->apply(GeometryUpdate().setXOffset(step + TILE_WIDTH));
+            if(step % 7 == 0)
+                screen.toggleBorderSelection(BorderHandle(screen.monitorId("2"), BorderIndex::BOTTOM), Qt::green);
+            published += publisher.publish(screen);
+        }
+        done.store(true);
+        for(std::thread& reader : readers)
+            reader.join();
+
+        QCOMPARE(torn.load(), 0);
+        QCOMPARE(published, steps);
+        QVERIFY(reads.load() > 0);
+        // without readers every replaced snapshot can be freed
+        QVERIFY(!publisher.publish(screen));
+        QCOMPARE(publisher.retiredCount(), 0);
+    }
+
+    void snap_data() {
+        monitorCountRows();
+    }
+
+    /// \brief Drag one monitor across the layout, POINTS snaps per iteration
+    void snap() {
+        QFETCH(int, monitors);
+        Screen screen;
+        fillGrid(screen, monitors);
+        const QVector<QPoint> points = samplePoints(screen);
+        const QRect visible = scaledLayout(screen);
+        const MonitorId dragged = screen.monitorId("0");
+
+        QBENCHMARK {
+            for(const QPoint& p : points)
+                screen.moveMonitors(dragged, p, p, visible);
+        }
+    }
+
+    /// \brief Dragging one monitor through a dense layout, at several zooms and pans, never leaves it overlapping another
+    void snapNeverOverlaps() {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> width(640, 3840);
+        std::uniform_int_distribution<int> height(480, 2160);
+        std::uniform_int_distribution<int> bar(0, 100);
+        std::uniform_int_distribution<int> step(-24, 24);
+
+        Screen screen;
+        QVector<MonitorSpec> specs;
+        for(int i = 0; i < 200; i++)
+            specs.push_back(MonitorSpec(QString::number(i), width(random), height(random), bar(random), bar(random)));
+        QCOMPARE(screen.packMonitors(specs).size(), specs.size());
+        const MonitorId dragged = screen.monitorId("0");
+
+        for(double scale : {1.0 / 10.0, 1.0 / 40.0, 1.0 / 200.0}) {
+            screen.setScale(scale);
+            const QRect area = scaledLayout(screen);
+            std::uniform_int_distribution<int> x(area.left() - area.width() / 4, area.right() + area.width() / 4);
+            std::uniform_int_distribution<int> y(area.top() - area.height() / 4, area.bottom() + area.height() / 4);
+
+            QPoint target(x(random), y(random));
+            for(int i = 0; i < 2000; i++) {
+                // mostly short drag steps through the layout, sometimes a jump, in a panned view
+                target = i % 50 == 0 ? QPoint(x(random), y(random)) : target + QPoint(step(random), step(random));
+                const QRect visible = area.translated(4 * step(random), 4 * step(random));
+                screen.moveMonitors(dragged, target, target, visible);
+
+                const QRect moved = screen.monitor(dragged)->boundingRectangle();
+                for(const Monitor& m : screen.monitors())
+                    QVERIFY2(m.id() == dragged || !m.boundingRectangle().intersects(moved),
+                             qPrintable(QString("overlaps %1 at scale %2, step %3").arg(m.getName()).arg(scale).arg(i)));
+            }
+        }
+        QCOMPARE(firstOverlap(screen), QString());
+    }
+
+    void zoom_data() {
+        monitorCountRows();
+    }
+
+    /// \brief Zoom between 1:1 and 1:2, rebuilding all scaled rectangles and the hit grid twice per iteration
+    void zoom() {
+        QFETCH(int, monitors);
+        Screen screen;
+        fillGrid(screen, monitors);
+
+        QBENCHMARK {
+            screen.setScale(1.0);
+            screen.setScale(0.5);
+        }
+    }
+
+    void deleteMonitor_data() {
+        monitorCountRows();
+    }
+
+    /// \brief Delete all monitors in a scattered order
+    void deleteMonitor() {
+        QFETCH(int, monitors);
+        Screen screen;
+        fillGrid(screen, monitors);
+
+        QVector<QString> names;
+        for(int i = 0; i < monitors; i++)
+            names.push_back(QString::number(i));
+        std::shuffle(names.begin(), names.end(), std::mt19937(1));
+
+        QBENCHMARK_ONCE {
+            for(const QString& name : names)
+                screen.deleteMonitor(name);
+        }
+        QCOMPARE(int(screen.monitors().size()), 0);
+    }
+
+    void drawBorders_data() {
+        monitorCountRows();
+    }
+
+    /// \brief Draw all borders into an offscreen image
+    void drawBorders() {
+        QFETCH(int, monitors);
+        Screen screen;
+        fillGrid(screen, monitors);
+        QImage image = offscreenImage(screen);
+        QPainter painter(&image);
+
+        QBENCHMARK {
+            screen.drawBorders(painter);
+        }
+    }
+
+    void drawBoundingRectangle_data() {
+        monitorCountRows();
+    }
+
+    /// \brief Draw all bounding rectangles into an offscreen image
+    void drawBoundingRectangle() {
+        QFETCH(int, monitors);
+        Screen screen;
+        fillGrid(screen, monitors);
+        QImage image = offscreenImage(screen);
+        QPainter painter(&image);
+
+        QBENCHMARK {
+            screen.drawBoundingRectangle(painter);
+        }
+    }
+
+    /// \brief Save and load a layout with negative offsets, letterbox bars and selections through both file formats
+    void layoutFileRoundTrip() {
+        Screen screen;
+        fillGrid(screen, 16);
+        screen.addMonitor("left panel", 1280, 1024, -1280, 0, 20, 10);
+        screen.toggleBorderSelection(BorderHandle(screen.monitorId("left panel"), BorderIndex::LEFT), Qt::red);
+        screen.toggleBorderSelection(BorderHandle(screen.monitorId("5"), BorderIndex::BOTTOM), Qt::green);
+        screen.toggleBorderSelection(BorderHandle(screen.monitorId("2"), BorderIndex::BOTTOM), Qt::green);
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        QString error;
+        const QString binaryPath = dir.filePath("layout.scwl");
+        QVERIFY(LayoutSerializer::saveBinaryFile(screen, binaryPath, &error));
+        Screen binary;
+        QVERIFY2(LayoutSerializer::loadFile(binary, binaryPath, &error), qPrintable(error));
+        QVERIFY(sameLayout(screen, binary));
+
+        const QString jsonPath = dir.filePath("layout.json");
+        QVERIFY(LayoutSerializer::saveJsonFile(screen, jsonPath, &error));
+        Screen json;
+        QVERIFY2(LayoutSerializer::loadFile(json, jsonPath, &error), qPrintable(error));
+        QVERIFY(sameLayout(screen, json));
+    }
+
+    /// \brief Grid walls and packed mixed resolutions are added below the layout without overlapping anything
+    void generatedLayoutsDoNotOverlap() {
+        Screen screen;
+        screen.addMonitor("primary", TILE_WIDTH, TILE_HEIGHT, -TILE_WIDTH / 2, -TILE_HEIGHT, 40, 30);
+        QVERIFY(screen.toggleSingleMonitorSelection("primary"));
+
+        const QVector<MonitorId> wall = screen.generateGrid("wall", 6, 8, TILE_WIDTH, TILE_HEIGHT, 12, 8);
+        QCOMPARE(wall.size(), 6 * 8);
+        QVERIFY(!wall.contains(INVALID_MONITOR_ID));
+        QCOMPARE(firstOverlap(screen), QString());
+
+        // generating clears the selection like every other addition
+        QVERIFY(!screen.currentlySelectedMonitor());
+
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> width(640, 3840);
+        std::uniform_int_distribution<int> height(480, 2160);
+        std::uniform_int_distribution<int> bar(0, 100);
+        QVector<MonitorSpec> specs;
+        for(int i = 0; i < 300; i++)
+            specs.push_back(MonitorSpec(QString("mixed %1").arg(i), width(random), height(random), bar(random), bar(random)));
+        const QVector<MonitorId> packed = screen.packMonitors(specs);
+        QCOMPARE(packed.size(), specs.size());
+        QVERIFY(!packed.contains(INVALID_MONITOR_ID));
+        QCOMPARE(firstOverlap(screen), QString());
+
+        // narrow shelves, and a second wall below the packed block
+        for(MonitorSpec& spec : specs)
+            spec.name += " narrow";
+        QCOMPARE(screen.packMonitors(specs, 4000).size(), specs.size());
+        QCOMPARE(screen.generateGrid("second wall", 3, 3, 1280, 1024).size(), 9);
+        QCOMPARE(firstOverlap(screen), QString());
+    }
+
+    /// \brief layoutBounds() unites the bounding rectangles that are hit-tested, snapped and drawn, through adds, edits and deletes
+    void layoutBoundsUniteBoundingRectangles() {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> offset(-20000, 20000);
+        std::uniform_int_distribution<int> size(640, 3840);
+        std::uniform_int_distribution<int> bar(0, 300);
+
+        Screen screen;
+        for(int i = 0; i < 100; i++)
+            screen.addMonitor(QString::number(i), size(random), size(random), offset(random), offset(random), bar(random), bar(random));
+
+        for(int i = 0; i < 300; i++) {
+            Monitor* m = screen.monitor(screen.monitorId(QString::number(i % 100)));
+            if(!m)
+                continue;
+            switch(i % 3) {
+            case 0:
+                m->setPosition(QPoint(offset(random), offset(random)));
+                break;
+            case 1:
+                m->apply(GeometryUpdate().setVerticalLetterboxBarWidth(bar(random)).setHorizontalLetterboxBarHeight(bar(random)));
+                break;
+            default:
+                if(i % 7 == 0)
+                    screen.deleteMonitor(m->getName());
+            }
+
+            QRect united;
+            for(const Monitor& n : screen.monitors())
+                united |= n.boundingRectangle();
+            QCOMPARE(screen.layoutBounds(), united);
+        }
+    }
+
+    /// \brief Undoing and redoing added or deleted monitors clears the selection through the screen, so the form and the delete button follow it
+    void undoWhileSelected() {
+        qRegisterMetaType<MonitorId>("MonitorId");
+        ScreenDisplayWidget widget;
+        Screen& screen = widget.screen();
+        widget.addMonitor("left", TILE_WIDTH, TILE_HEIGHT);
+        widget.addMonitor("right", TILE_WIDTH, TILE_HEIGHT, TILE_WIDTH);
+
+        QSignalSpy selected(&widget, SIGNAL(onMonitorSelected(MonitorId)));
+        QSignalSpy deselected(&widget, SIGNAL(onMonitorDeSelected()));
+
+        // undoing the addition of the selected monitor
+        QVERIFY(screen.toggleSingleMonitorSelection("right"));
+        QCOMPARE(selected.count(), 1);
+        widget.history()->undo();
+        QCOMPARE(screen.monitorId("right"), INVALID_MONITOR_ID);
+        QVERIFY(!widget.currentlySelectedMonitor());
+        QCOMPARE(deselected.count(), 1);
+
+        // redoing it while another monitor is selected
+        QVERIFY(screen.toggleSingleMonitorSelection("left"));
+        widget.history()->redo();
+        QVERIFY(screen.monitorId("right") != INVALID_MONITOR_ID);
+        QVERIFY(!widget.currentlySelectedMonitor());
+        QCOMPARE(deselected.count(), 2);
+
+        // undoing the deletion of the selected monitor while another one is selected
+        QVERIFY(screen.toggleSingleMonitorSelection("left"));
+        widget.deleteMonitor("left");
+        QVERIFY(!widget.currentlySelectedMonitor());
+        QCOMPARE(deselected.count(), 3);
+        QVERIFY(screen.toggleSingleMonitorSelection("right"));
+        widget.history()->undo();
+        QVERIFY(screen.monitorId("left") != INVALID_MONITOR_ID);
+        QVERIFY(!widget.currentlySelectedMonitor());
+        QCOMPARE(deselected.count(), 4);
+        QCOMPARE(selected.count(), 4);
+    }
+
+private:
+    /// \brief Scale screen to fit MAX_IMAGE_SIZE, and return an image of the scaled layout
+    static QImage offscreenImage(Screen& screen) {
+        const QRect bounds = screen.layoutBounds();
+        screen.setScale(std::min(screen.scale(), double(MAX_IMAGE_SIZE) / std::max(bounds.width(), bounds.height())));
+
+        QImage image(scaledLayout(screen).size(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+        return image;
+    }
+};
+
+int main(int argc, char** argv) {
+    // everything is drawn into images and widgets are never shown, no display is needed
+    if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    ScreenBench bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "screenbench.moc"
@@ -0,0 +1,38 @@
+#-------------------------------------------------
+#
+# Headless benchmarks of the Screen engine, run with
+#   qmake && make && ./screenbench
+# Pass -minimumvalue, -iterations etc. as for any QtTest binary.
+# The vector code is tested against plain loops; build with
+#   qmake CONFIG+=avx2    for the AVX2 paths
+#   qmake CONFIG+=scalar  for the scalar fallbacks
+# and snapshotPublisherStress with
+#   qmake CONFIG+=tsan    for ThreadSanitizer
+#
+#-------------------------------------------------
+
+QT       += core gui testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = screenbench
+CONFIG += console testcase thread
+CONFIG -= app_bundle
+TEMPLATE = app
+
+# c++11
+CONFIG += c++11
+
+INCLUDEPATH += ..
+
+avx2: QMAKE_CXXFLAGS += -mavx2
+scalar: DEFINES += SCREENCONFIGWIDGET_NO_SIMD
+tsan {
+    QMAKE_CXXFLAGS += -fsanitize=thread
+    QMAKE_LFLAGS += -fsanitize=thread
+}
+
+SOURCES += screenbench.cpp
+
+# for moc
+HEADERS  += ../screenconfiglayout.h
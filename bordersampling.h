@@ -0,0 +1,474 @@
+#ifndef BORDERSAMPLING_H
+#define BORDERSAMPLING_H
+
+#include "screenconfiglayout.h"
+#include "screensnapshot.h"
+
+#include <QRect>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+#include <assert.h>
+
+namespace ScreenConfigWidget {
+
+/**
+ * @brief One row of pixels sampled for an LED, in desktop coordinates
+ */
+struct SamplingSpan {
+    qint32 x;///< desktop x of the first pixel
+    qint32 y;///< desktop row
+    quint32 length;///< number of pixels in the row
+    quint32 led;///< LED the pixels belong to
+};
+
+}
+
+// before the first QVector<SamplingSpan>, so it takes effect
+Q_DECLARE_TYPEINFO(ScreenConfigWidget::SamplingSpan, Q_PRIMITIVE_TYPE);
+
+namespace ScreenConfigWidget {
+
+/**
+ * @brief A captured frame of BGRA pixels: blue, green, red and alpha bytes per pixel
+ */
+struct FrameView {
+    const uchar* pixels = nullptr;///< first pixel of the top row
+    int stride = 0;///< bytes from the start of one row to the next
+    QRect area;///< desktop area shown by the frame
+};
+
+/**
+ * @brief Channel sums of sampled BGRA pixels
+ */
+struct ColorSum {
+    quint64 channels[4] = {0, 0, 0, 0};///< sums of blue, green, red and alpha, in memory order
+    quint64 pixels = 0;///< number of pixels summed
+
+    /// \brief Rounded mean color, black if no pixel was summed
+    QRgb mean() const {
+        if(!pixels)
+            return qRgba(0, 0, 0, 0);
+        const quint64 half = pixels / 2;
+        return qRgba(int((channels[2] + half) / pixels), int((channels[1] + half) / pixels),
+                     int((channels[0] + half) / pixels), int((channels[3] + half) / pixels));
+    }
+};
+
+/**
+ * @brief A precompiled table mapping LEDs to the desktop pixels they sample
+ *
+ * compile() walks the selected borders of a Screen, or of a ScreenSnapshot of it, in BorderIndex order
+ * (bottom, right, top, left), each side in the order the user selected the borders, and hands out
+ * consecutive LED indices.
+ * The LEDs of a side are distributed over its borders in proportion to their length, and every
+ * LED covers an equal part of its border, along increasing desktop coordinates.
+ *
+ * The area of each LED is stored as row spans sorted by row and column, so a frame can be streamed
+ * through the table top to bottom without any geometry math; sample() does that for BGRA frames.
+ */
+class SamplingMap {
+public:
+    /**
+     * @brief Compile the selected borders of screen into sampling spans
+     * @param ledsPerSide number of LEDs per BorderIndex, shared by all selected borders of that side
+     */
+    void compile(const Screen& screen, const int ledsPerSide[4]) {
+        clear();
+
+        for(int side = 0; side < 4; side++) {
+            const QVector<BorderHandle>& selected = screen.selectedBorders(BorderIndex(side));
+            compileSide(BorderIndex(side), selected.constData(), selected.size(), ledsPerSide[side],
+                        [&](int i) -> const Geometry& { return screen.border(selected.at(i))->geometry; });
+        }
+
+        sortSpans();
+    }
+
+    /**
+     * @brief Compile the selected borders of a snapshot, e.g. on a worker thread holding it through a SnapshotReader
+     *
+     * Gives the same table as compile() on the Screen the snapshot was taken of.
+     */
+    void compile(const ScreenSnapshot& snapshot, const int ledsPerSide[4]) {
+        clear();
+
+        for(int side = 0; side < 4; side++) {
+            const std::vector<Border>& borders = snapshot.selectedBorders[side];
+            assert(borders.size() == snapshot.selectedHandles[side].size());
+            compileSide(BorderIndex(side), snapshot.selectedHandles[side].data(), int(borders.size()), ledsPerSide[side],
+                        [&](int i) -> const Geometry& { return borders[size_t(i)].geometry; });
+        }
+
+        sortSpans();
+    }
+
+    /// \brief Compile one LED per selected border, e.g. to get the mean color of every border segment
+    void compileBorders(const Screen& screen) {
+        clear();
+
+        for(int side = 0; side < 4; side++)
+            for(const BorderHandle& h : screen.selectedBorders(BorderIndex(side)))
+                addLed(h, screen.border(h)->geometry.qRect());
+
+        sortSpans();
+    }
+
+    /// \brief Compile one LED per selected border of a snapshot
+    void compileBorders(const ScreenSnapshot& snapshot) {
+        clear();
+
+        for(int side = 0; side < 4; side++) {
+            assert(snapshot.selectedBorders[side].size() == snapshot.selectedHandles[side].size());
+            for(size_t i = 0; i < snapshot.selectedBorders[side].size(); i++)
+                addLed(snapshot.selectedHandles[side][i], snapshot.selectedBorders[side][i].geometry.qRect());
+        }
+
+        sortSpans();
+    }
+
+    /**
+     * @brief Average the pixels of every LED in a frame
+     *
+     * Rows are summed with SSE2 or AVX2 where available. Pixels outside the frame are skipped;
+     * LEDs without any sampled pixel are black.
+     * @param colors receives one color per LED
+     * @param subsample sample only every n-th row and every n-th pixel of a row
+     */
+    void sample(const FrameView& frame, QVector<QRgb>& colors, int subsample = 1) const {
+        QVector<ColorSum> sums(ledCount());
+        accumulate(frame, sums.data(), 0, mSpans.size(), subsample);
+
+        colors.resize(ledCount());
+        for(int i = 0; i < sums.size(); i++)
+            colors[i] = sums.at(i).mean();
+    }
+
+    /**
+     * @brief Add the pixels of the spans [firstSpan, lastSpan) to the per LED sums
+     * @param sums ledCount() sums, indexed by LED
+     */
+    void accumulate(const FrameView& frame, ColorSum* sums, int firstSpan, int lastSpan, int subsample = 1) const {
+        assert(subsample > 0);
+        const SamplingSpan* spans = mSpans.constData();
+
+        for(int s = firstSpan; s < lastSpan; s++)
+            accumulateSpan(frame, spans[s], sums[spans[s].led], subsample);
+    }
+
+    /**
+     * @brief Add the pixels of the LEDs [firstLed, lastLed) to their sums
+     *
+     * Only the sums of these LEDs are written, so disjoint LED ranges can be accumulated concurrently.
+     * @param sums ledCount() sums, indexed by LED
+     */
+    void accumulateLeds(const FrameView& frame, ColorSum* sums, int firstLed, int lastLed, int subsample = 1) const {
+        assert(subsample > 0);
+        const SamplingSpan* spans = mSpans.constData();
+        const int* ledSpans = mLedSpans.constData();
+
+        for(int led = firstLed; led < lastLed; led++)
+            for(int s = mLedSpanBegin.at(led); s < mLedSpanBegin.at(led + 1); s++)
+                accumulateSpan(frame, spans[ledSpans[s]], sums[led], subsample);
+    }
+
+    /// \brief Add count consecutive BGRA pixels to sum
+    static void accumulateRow(const uchar* row, int count, ColorSum& sum) {
+        int i = 0;
+
+#if defined(SCREENCONFIGWIDGET_HAVE_AVX2)
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i total = zero;
+        while(count - i >= 8) {
+            // the 16 bit sums of 128 iterations of two pixels per channel can not overflow
+            const int end = i + std::min((count - i) / 8, 128) * 8;
+            __m256i partial = zero;
+            for(; i < end; i += 8) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + 4 * i));
+                partial = _mm256_add_epi16(partial, _mm256_add_epi16(_mm256_unpacklo_epi8(v, zero), _mm256_unpackhi_epi8(v, zero)));
+            }
+            total = _mm256_add_epi32(total, _mm256_add_epi32(_mm256_unpacklo_epi16(partial, zero), _mm256_unpackhi_epi16(partial, zero)));
+        }
+        quint32 lanes[8];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+        for(int c = 0; c < 4; c++)
+            sum.channels[c] += quint64(lanes[c]) + lanes[c + 4];
+#elif defined(SCREENCONFIGWIDGET_HAVE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i total = zero;
+        while(count - i >= 4) {
+            // the 16 bit sums of 128 iterations of two pixels per channel can not overflow
+            const int end = i + std::min((count - i) / 4, 128) * 4;
+            __m128i partial = zero;
+            for(; i < end; i += 4) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 4 * i));
+                partial = _mm_add_epi16(partial, _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)));
+            }
+            total = _mm_add_epi32(total, _mm_add_epi32(_mm_unpacklo_epi16(partial, zero), _mm_unpackhi_epi16(partial, zero)));
+        }
+        quint32 lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), total);
+        for(int c = 0; c < 4; c++)
+            sum.channels[c] += lanes[c];
+#endif
+
+        for(; i < count; i++)
+            for(int c = 0; c < 4; c++)
+                sum.channels[c] += row[4 * i + c];
+        sum.pixels += quint64(count);
+    }
+
+    /// \brief Add count BGRA pixels, step pixels apart, to sum \overload
+    static void accumulateRow(const uchar* row, int count, int step, ColorSum& sum) {
+        for(int i = 0; i < count; i++, row += 4 * step)
+            for(int c = 0; c < 4; c++)
+                sum.channels[c] += row[c];
+        sum.pixels += quint64(count);
+    }
+
+    /// \brief Remove all LEDs and spans
+    void clear() {
+        mSpans.clear();
+        mLedAreas.clear();
+        mLedBorders.clear();
+        mLedPixels.clear();
+        mLedSpans.clear();
+        mLedSpanBegin.clear();
+        mBounds = QRect();
+    }
+
+    /// \brief Number of LEDs in the table
+    int ledCount() const {
+        return mLedAreas.size();
+    }
+
+    /// \brief All spans, sorted by row and column
+    const QVector<SamplingSpan>& spans() const {
+        return mSpans;
+    }
+
+    /// \brief Desktop area sampled for an LED
+    QRect ledArea(int led) const {
+        return mLedAreas.at(led);
+    }
+
+    /// \brief Border an LED belongs to
+    BorderHandle ledBorder(int led) const {
+        return mLedBorders.at(led);
+    }
+
+    /// \brief Number of pixels sampled for an LED, to average its accumulated color
+    quint32 ledPixels(int led) const {
+        return mLedPixels.at(led);
+    }
+
+    /// \brief Desktop area covered by all spans; frames must cover it to be sampled
+    QRect bounds() const {
+        return mBounds;
+    }
+
+private:
+    void sortSpans() {
+        // sort the rows for sequential frame access
+        std::sort(mSpans.begin(), mSpans.end(), [](const SamplingSpan& a, const SamplingSpan& b) {
+            return a.y != b.y ? a.y < b.y : a.x < b.x;
+        });
+
+        // group the span indices by LED, keeping the row order within each LED
+        mLedSpanBegin.fill(0, ledCount() + 1);
+        for(const SamplingSpan& span : mSpans)
+            mLedSpanBegin[int(span.led) + 1]++;
+        for(int led = 0; led < ledCount(); led++)
+            mLedSpanBegin[led + 1] += mLedSpanBegin.at(led);
+
+        QVector<int> next = mLedSpanBegin;
+        mLedSpans.resize(mSpans.size());
+        for(int s = 0; s < mSpans.size(); s++)
+            mLedSpans[next[int(mSpans.at(s).led)]++] = s;
+    }
+
+    static void accumulateSpan(const FrameView& frame, const SamplingSpan& span, ColorSum& sum, int subsample) {
+        if(span.y < frame.area.top() || span.y > frame.area.bottom() || gridOffset(span.y, subsample) != 0)
+            return;
+
+        // clip the span to the frame, and align it to the subsampling grid
+        int first = std::max(span.x, frame.area.left());
+        const int last = std::min(span.x + int(span.length) - 1, frame.area.right());
+        if(gridOffset(first, subsample) != 0)
+            first += subsample - gridOffset(first, subsample);
+        if(first > last)
+            return;
+
+        const uchar* row = frame.pixels + qint64(span.y - frame.area.top()) * frame.stride + 4 * (first - frame.area.left());
+        if(subsample == 1)
+            accumulateRow(row, last - first + 1, sum);
+        else
+            accumulateRow(row, (last - first) / subsample + 1, subsample, sum);
+    }
+
+    /// \brief Distance of a desktop coordinate to the previous multiple of step, also for negative coordinates
+    static int gridOffset(int coordinate, int step) {
+        return ((coordinate % step) + step) % step;
+    }
+
+    static qint64 borderLength(const Geometry& g, bool horizontal) {
+        return qint64(horizontal ? g.width : g.height);
+    }
+
+    /**
+     * @brief Add the LEDs of the count selected borders of one side
+     * @param geometryOf returns the geometry of the i-th border, so Screen and ScreenSnapshot share the distribution
+     */
+    template<typename GeometryOf>
+    void compileSide(BorderIndex side, const BorderHandle* selected, int count, int leds, GeometryOf geometryOf) {
+        const bool horizontal = side == BorderIndex::BOTTOM || side == BorderIndex::TOP;
+
+        // total border length of the side
+        qint64 total = 0;
+        for(int i = 0; i < count; i++)
+            total += borderLength(geometryOf(i), horizontal);
+        if(total <= 0 || leds <= 0)
+            return;
+
+        // give every border its share of the LEDs, rounding on the cumulative length so the sum is exact
+        qint64 covered = 0;
+        for(int i = 0; i < count; i++) {
+            const Geometry& g = geometryOf(i);
+            const qint64 length = borderLength(g, horizontal);
+            const int first = int(leds * covered / total);
+            covered += length;
+            const int share = int(leds * covered / total) - first;
+
+            for(int l = 0; l < share; l++) {
+                const qint64 begin = length * l / share;
+                const qint64 end = length * (l + 1) / share;
+                QRect area = horizontal ?
+                            QRect(int(g.xOffset + begin), int(g.yOffset), int(end - begin), int(g.height)) :
+                            QRect(int(g.xOffset), int(g.yOffset + begin), int(g.width), int(end - begin));
+                addLed(selected[i], area);
+            }
+        }
+    }
+
+    void addLed(const BorderHandle& border, const QRect& area) {
+        const quint32 led = quint32(mLedAreas.size());
+        mLedAreas.push_back(area);
+        mLedBorders.push_back(border);
+        if(area.isEmpty()) {
+            mLedPixels.push_back(0);
+            return;
+        }
+        mLedPixels.push_back(quint32(area.width()) * quint32(area.height()));
+        mBounds |= area;
+
+        for(int y = area.top(); y <= area.bottom(); y++)
+            mSpans.push_back(SamplingSpan{area.left(), y, quint32(area.width()), led});
+    }
+
+    QVector<SamplingSpan> mSpans;///< row spans of all LEDs, sorted by row and column
+    QVector<QRect> mLedAreas;///< desktop area per LED
+    QVector<BorderHandle> mLedBorders;///< border per LED
+    QVector<quint32> mLedPixels;///< pixel count per LED
+    QVector<int> mLedSpans;///< indices into mSpans, grouped by LED
+    QVector<int> mLedSpanBegin;///< first entry in mLedSpans per LED, plus the end
+    QRect mBounds;///< union of all LED areas
+};
+
+/**
+ * @brief Samples frames through a SamplingMap on a pool of worker threads
+ *
+ * Every frame is split into tasks of consecutive LEDs, i.e. border segments, with about the same
+ * number of pixels each. There are several tasks per thread, so threads that finish early pick up
+ * the remaining ones. Each LED is summed by exactly one task in a fixed span order, so the result
+ * does not depend on the thread count or scheduling.
+ */
+class ParallelSampler {
+public:
+    /// \brief Create a sampler with threadCount worker threads
+    explicit ParallelSampler(int threadCount = QThread::idealThreadCount()) {
+        setThreadCount(threadCount);
+    }
+
+    ~ParallelSampler() {
+        mPool.waitForDone();
+    }
+
+    /// \brief Set the number of worker threads; 1 samples on the calling thread
+    void setThreadCount(int threadCount) {
+        mThreadCount = std::max(1, threadCount);
+        mPool.setMaxThreadCount(mThreadCount);
+    }
+
+    int threadCount() const {
+        return mThreadCount;
+    }
+
+    /**
+     * @brief Average the pixels of every LED in a frame, like SamplingMap::sample()
+     *
+     * Blocks until all tasks are done; the frame must stay valid until then.
+     */
+    void sample(const SamplingMap& map, const FrameView& frame, QVector<QRgb>& colors, int subsample = 1) {
+        const int leds = map.ledCount();
+        mSums.fill(ColorSum(), leds);
+
+        if(mThreadCount == 1 || leds < 2) {
+            map.accumulateLeds(frame, mSums.data(), 0, leds, subsample);
+        }
+        else {
+            // cut the LEDs into tasks of about the same pixel count
+            qint64 total = 0;
+            for(int led = 0; led < leds; led++)
+                total += map.ledPixels(led);
+
+            const int tasks = std::min(leds, mThreadCount * TASKS_PER_THREAD);
+            qint64 covered = 0;
+            int first = 0;
+            for(int led = 0, task = 1; led < leds; led++) {
+                covered += map.ledPixels(led);
+                if(led == leds - 1 || covered * tasks >= total * task) {
+                    mPool.start(new SampleTask(map, frame, mSums.data(), first, led + 1, subsample));
+                    first = led + 1;
+                    task++;
+                }
+            }
+            mPool.waitForDone();
+        }
+
+        colors.resize(leds);
+        for(int i = 0; i < leds; i++)
+            colors[i] = mSums.at(i).mean();
+    }
+
+private:
+    static const int TASKS_PER_THREAD = 4;///< tasks per worker thread, to balance uneven border segments
+
+    /// \brief Sums the LEDs [first, last) of a frame
+    class SampleTask : public QRunnable {
+    public:
+        SampleTask(const SamplingMap& map, const FrameView& frame, ColorSum* sums, int first, int last, int subsample) :
+            mMap(map), mFrame(frame), mSums(sums), mFirst(first), mLast(last), mSubsample(subsample) {
+        }
+
+        void run() Q_DECL_OVERRIDE {
+            mMap.accumulateLeds(mFrame, mSums, mFirst, mLast, mSubsample);
+        }
+
+    private:
+        const SamplingMap& mMap;
+        const FrameView mFrame;
+        ColorSum* mSums;
+        const int mFirst, mLast, mSubsample;
+    };
+
+    QThreadPool mPool;///< worker threads
+    int mThreadCount = 1;///< configured number of worker threads
+    QVector<ColorSum> mSums;///< per LED sums of the current frame
+};
+
+}
+
+#endif // BORDERSAMPLING_H
@@ -0,0 +1,448 @@
+#ifndef LAYOUTSERIALIZER_H
+#define LAYOUTSERIALIZER_H
+
+#include "screenconfiglayout.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QtEndian>
+
+#include <string.h>
+
+namespace ScreenConfigWidget {
+
+/**
+ * @brief Import and export of the full Screen state: monitors, border colors and border selections
+ *
+ * Two formats are supported:
+ *  - a compact binary format made of fixed-size little endian records followed by a UTF-8 string
+ *    table. Files are memory mapped and the records used in place, so loading only validates
+ *    offsets and does not parse field by field.
+ *  - a human readable JSON document, for editing layouts by hand.
+ *
+ * Both formats carry a version number; files with an unknown version are rejected.
+ * loadFile() detects the format from the file contents.
+ */
+class LayoutSerializer {
+public:
+    static const quint32 BINARY_VERSION = 1;///< version written to and accepted from binary files
+    static const int JSON_VERSION = 1;///< version written to and accepted from JSON documents
+
+    /*
+     *
+     * BINARY
+     *
+     */
+
+    /// \brief Serialize the screen into the binary format
+    static QByteArray toBinary(const Screen& screen) {
+        const std::vector<Monitor>& monitors = screen.monitors();
+
+        // slot of every monitor, to store selections as record indices
+        QHash<MonitorId, quint32> records;
+        records.reserve(int(monitors.size()));
+        for(size_t i = 0; i < monitors.size(); i++)
+            records.insert(monitors[i].id(), quint32(i));
+
+        // build the string table
+        QByteArray strings;
+        std::vector<BinaryMonitor> monitorRecords(monitors.size());
+        for(size_t i = 0; i < monitors.size(); i++) {
+            const Monitor& m = monitors[i];
+            const QByteArray name = m.getName().toUtf8();
+
+            BinaryMonitor& r = monitorRecords[i];
+            r.nameOffset = qToLittleEndian(quint32(strings.size()));
+            r.nameLength = qToLittleEndian(quint32(name.size()));
+            r.width = qToLittleEndian(qint32(m.width()));
+            r.height = qToLittleEndian(qint32(m.height()));
+            r.xOffset = qToLittleEndian(qint32(m.xOffset()));
+            r.yOffset = qToLittleEndian(qint32(m.yOffset()));
+            r.verticalLetterboxBarWidth = qToLittleEndian(qint32(m.verticalLetterboxBarWidth()));
+            r.horizontalLetterboxBarHeight = qToLittleEndian(qint32(m.horizontalLetterboxBarHeight()));
+            for(int b = 0; b < 4; b++)
+                r.borderColor[b] = qToLittleEndian(quint32(m[BorderIndex(b)].drawColor.rgba()));
+
+            strings.append(name);
+        }
+
+        std::vector<quint32> selections;
+        BinaryHeader header;
+        memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+        header.version = qToLittleEndian(BINARY_VERSION);
+        header.headerSize = qToLittleEndian(quint32(sizeof(BinaryHeader)));
+        header.monitorCount = qToLittleEndian(quint32(monitors.size()));
+        for(int i = 0; i < 4; i++) {
+            const QVector<BorderHandle>& selected = screen.selectedBorders(BorderIndex(i));
+            header.selectedCount[i] = qToLittleEndian(quint32(selected.size()));
+            for(const BorderHandle& h : selected)
+                selections.push_back(qToLittleEndian(records.value(h.monitor)));
+        }
+        header.stringBytes = qToLittleEndian(quint32(strings.size()));
+
+        QByteArray result;
+        result.reserve(int(sizeof(BinaryHeader) + monitorRecords.size() * sizeof(BinaryMonitor)
+                           + selections.size() * sizeof(quint32)) + strings.size());
+        result.append(reinterpret_cast<const char*>(&header), int(sizeof(BinaryHeader)));
+        if(!monitorRecords.empty())
+            result.append(reinterpret_cast<const char*>(monitorRecords.data()), int(monitorRecords.size() * sizeof(BinaryMonitor)));
+        if(!selections.empty())
+            result.append(reinterpret_cast<const char*>(selections.data()), int(selections.size() * sizeof(quint32)));
+        result.append(strings);
+        return result;
+    }
+
+    /**
+     * @brief Replace the contents of screen with a binary layout
+     *
+     * The data is validated completely before the screen is touched, so a rejected layout leaves
+     * the screen unchanged.
+     * @param data binary layout, e.g. a memory mapped file
+     * @param size size of data in bytes
+     * @param error receives a description of the problem if the layout is rejected
+     * @return true if the layout was loaded
+     */
+    static bool fromBinary(Screen& screen, const uchar* data, qint64 size, QString* error = nullptr) {
+        BinaryHeader header;
+        if(!data || size < qint64(sizeof(BinaryHeader)))
+            return fail(error, "Binary layout is truncated");
+        memcpy(&header, data, sizeof(BinaryHeader));
+
+        if(memcmp(header.magic, BINARY_MAGIC, sizeof(header.magic)) != 0)
+            return fail(error, "Not a binary layout");
+        if(qFromLittleEndian(header.version) != BINARY_VERSION)
+            return fail(error, QString("Unsupported binary layout version %1").arg(qFromLittleEndian(header.version)));
+        if(qFromLittleEndian(header.headerSize) != sizeof(BinaryHeader))
+            return fail(error, "Binary layout header is corrupt");
+
+        // check that all sections fit into the data
+        const qint64 monitorCount = qFromLittleEndian(header.monitorCount);
+        qint64 selectionCount = 0;
+        for(int i = 0; i < 4; i++)
+            selectionCount += qFromLittleEndian(header.selectedCount[i]);
+        const qint64 stringBytes = qFromLittleEndian(header.stringBytes);
+
+        const qint64 monitorsOffset = sizeof(BinaryHeader);
+        const qint64 selectionsOffset = monitorsOffset + monitorCount * qint64(sizeof(BinaryMonitor));
+        const qint64 stringsOffset = selectionsOffset + selectionCount * qint64(sizeof(quint32));
+        if(stringsOffset + stringBytes > size)
+            return fail(error, "Binary layout is truncated");
+
+        const uchar* monitorData = data + monitorsOffset;
+        const uchar* selectionData = data + selectionsOffset;
+        const char* strings = reinterpret_cast<const char*>(data + stringsOffset);
+
+        // validate the records before modifying the screen
+        QVector<QString> names;
+        names.reserve(int(monitorCount));
+        QSet<QString> uniqueNames;
+        uniqueNames.reserve(int(monitorCount));
+        for(qint64 i = 0; i < monitorCount; i++) {
+            BinaryMonitor r;
+            memcpy(&r, monitorData + i * sizeof(BinaryMonitor), sizeof(BinaryMonitor));
+            if(qint64(qFromLittleEndian(r.nameOffset)) + qFromLittleEndian(r.nameLength) > stringBytes)
+                return fail(error, QString("Name of monitor %1 is out of bounds").arg(i));
+            names.push_back(QString::fromUtf8(strings + qFromLittleEndian(r.nameOffset), int(qFromLittleEndian(r.nameLength))));
+            if(uniqueNames.contains(names.back()))
+                return fail(error, QString("Duplicate monitor name %1").arg(names.back()));
+            uniqueNames.insert(names.back());
+            if(!Monitor::isValidGeometry(GeometryUpdate()
+                                         .setWidth(qFromLittleEndian(r.width))
+                                         .setHeight(qFromLittleEndian(r.height))
+                                         .setXOffset(qFromLittleEndian(r.xOffset))
+                                         .setYOffset(qFromLittleEndian(r.yOffset))
+                                         .setVerticalLetterboxBarWidth(qFromLittleEndian(r.verticalLetterboxBarWidth))
+                                         .setHorizontalLetterboxBarHeight(qFromLittleEndian(r.horizontalLetterboxBarHeight))))
+                return fail(error, QString("Geometry of monitor %1 is invalid").arg(i));
+        }
+        for(qint64 i = 0; i < selectionCount; i++) {
+            quint32 record;
+            memcpy(&record, selectionData + i * sizeof(quint32), sizeof(quint32));
+            if(qFromLittleEndian(record) >= monitorCount)
+                return fail(error, QString("Selected border %1 references a missing monitor").arg(i));
+        }
+
+        // load the monitors
+        screen.clear();
+        screen.reserve(int(monitorCount));
+        QVector<MonitorId> ids;
+        ids.reserve(int(monitorCount));
+        for(qint64 i = 0; i < monitorCount; i++) {
+            BinaryMonitor r;
+            memcpy(&r, monitorData + i * sizeof(BinaryMonitor), sizeof(BinaryMonitor));
+
+            screen.addMonitor(names.at(int(i)), qFromLittleEndian(r.width), qFromLittleEndian(r.height),
+                              qFromLittleEndian(r.xOffset), qFromLittleEndian(r.yOffset),
+                              qFromLittleEndian(r.verticalLetterboxBarWidth),
+                              qFromLittleEndian(r.horizontalLetterboxBarHeight));
+
+            const MonitorId id = screen.monitorId(names.at(int(i)));
+            ids.push_back(id);
+            for(int b = 0; b < 4; b++)
+                screen.selectBorder(BorderHandle(id, BorderIndex(b)), QColor::fromRgba(qFromLittleEndian(r.borderColor[b])));
+        }
+
+        // load the border selections
+        qint64 selection = 0;
+        for(int i = 0; i < 4; i++) {
+            const quint32 count = qFromLittleEndian(header.selectedCount[i]);
+            QVector<BorderHandle> selected;
+            selected.reserve(int(count));
+            for(quint32 s = 0; s < count; s++, selection++) {
+                quint32 record;
+                memcpy(&record, selectionData + selection * sizeof(quint32), sizeof(quint32));
+                selected.push_back(BorderHandle(ids.at(int(qFromLittleEndian(record))), BorderIndex(i)));
+            }
+            screen.setSelectedBorders(BorderIndex(i), selected);
+        }
+
+        return true;
+    }
+
+    /// \brief Replace the contents of screen with a binary layout \overload
+    static bool fromBinary(Screen& screen, const QByteArray& data, QString* error = nullptr) {
+        return fromBinary(screen, reinterpret_cast<const uchar*>(data.constData()), data.size(), error);
+    }
+
+    /*
+     *
+     * JSON
+     *
+     */
+
+    /// \brief Serialize the screen into a JSON object
+    static QJsonObject toJson(const Screen& screen) {
+        QJsonArray monitors;
+        for(const Monitor& m : screen.monitors()) {
+            QJsonArray colors;
+            for(int b = 0; b < 4; b++)
+                colors.append(m[BorderIndex(b)].drawColor.name(QColor::HexArgb));
+
+            QJsonObject monitor;
+            monitor.insert("name", m.getName());
+            monitor.insert("width", int(m.width()));
+            monitor.insert("height", int(m.height()));
+            monitor.insert("xOffset", int(m.xOffset()));
+            monitor.insert("yOffset", int(m.yOffset()));
+            monitor.insert("verticalLetterboxBarWidth", int(m.verticalLetterboxBarWidth()));
+            monitor.insert("horizontalLetterboxBarHeight", int(m.horizontalLetterboxBarHeight()));
+            monitor.insert("borderColors", colors);
+            monitors.append(monitor);
+        }
+
+        // selections reference monitors by name
+        QJsonObject selections;
+        for(int i = 0; i < 4; i++) {
+            QJsonArray selected;
+            for(const BorderHandle& h : screen.selectedBorders(BorderIndex(i)))
+                selected.append(screen.monitor(h.monitor)->getName());
+            selections.insert(borderName(BorderIndex(i)), selected);
+        }
+
+        QJsonObject result;
+        result.insert("version", JSON_VERSION);
+        result.insert("monitors", monitors);
+        result.insert("selectedBorders", selections);
+        return result;
+    }
+
+    /**
+     * @brief Replace the contents of screen with a JSON layout
+     *
+     * A rejected layout leaves the screen unchanged.
+     * @param error receives a description of the problem if the layout is rejected
+     * @return true if the layout was loaded
+     */
+    static bool fromJson(Screen& screen, const QJsonObject& json, QString* error = nullptr) {
+        if(json.value("version").toInt(-1) != JSON_VERSION)
+            return fail(error, QString("Unsupported JSON layout version %1").arg(json.value("version").toInt(-1)));
+
+        const QJsonArray monitors = json.value("monitors").toArray();
+
+        // validate the document before modifying the screen
+        struct JsonMonitor {
+            QString name;
+            int values[6];
+            QColor colors[4];
+        };
+        std::vector<JsonMonitor> records(size_t(monitors.count()));
+        QSet<QString> names;
+        names.reserve(monitors.count());
+        for(int i = 0; i < monitors.count(); i++) {
+            const QJsonObject m = monitors.at(i).toObject();
+            JsonMonitor& r = records[size_t(i)];
+            r.name = m.value("name").toString();
+            if(names.contains(r.name))
+                return fail(error, QString("Duplicate monitor name %1").arg(r.name));
+            names.insert(r.name);
+
+            const char* const fields[] = {"width", "height", "xOffset", "yOffset", "verticalLetterboxBarWidth", "horizontalLetterboxBarHeight"};
+            for(int f = 0; f < 6; f++) {
+                // offsets may be negative, but every value must be an integer
+                const QJsonValue value = m.value(fields[f]);
+                r.values[f] = value.toInt();
+                if(!value.isDouble() || r.values[f] != value.toDouble())
+                    return fail(error, QString("Monitor %1 has no valid %2").arg(r.name).arg(fields[f]));
+            }
+            if(!Monitor::isValidGeometry(GeometryUpdate().setWidth(r.values[0]).setHeight(r.values[1]).setXOffset(r.values[2])
+                                         .setYOffset(r.values[3]).setVerticalLetterboxBarWidth(r.values[4])
+                                         .setHorizontalLetterboxBarHeight(r.values[5])))
+                return fail(error, QString("Geometry of monitor %1 is invalid").arg(r.name));
+
+            // border colors are optional, borders without one are unselected
+            const QJsonArray colors = m.value("borderColors").toArray();
+            for(int b = 0; b < 4; b++) {
+                r.colors[b] = b < colors.count() ? QColor(colors.at(b).toString()) : QColor(Qt::GlobalColor::lightGray);
+                if(!r.colors[b].isValid())
+                    return fail(error, QString("Monitor %1 has an invalid border color").arg(r.name));
+            }
+        }
+
+        const QJsonObject selections = json.value("selectedBorders").toObject();
+        QJsonArray selected[4];
+        for(int i = 0; i < 4; i++) {
+            selected[i] = selections.value(borderName(BorderIndex(i))).toArray();
+            for(int s = 0; s < selected[i].count(); s++)
+                if(!names.contains(selected[i].at(s).toString()))
+                    return fail(error, QString("Selected %1 border references missing monitor %2")
+                                .arg(borderName(BorderIndex(i))).arg(selected[i].at(s).toString()));
+        }
+
+        // load the monitors and selections
+        screen.clear();
+        screen.reserve(int(records.size()));
+        for(const JsonMonitor& r : records) {
+            screen.addMonitor(r.name, r.values[0], r.values[1], r.values[2], r.values[3], r.values[4], r.values[5]);
+            const MonitorId id = screen.monitorId(r.name);
+            for(int b = 0; b < 4; b++)
+                screen.selectBorder(BorderHandle(id, BorderIndex(b)), r.colors[b]);
+        }
+        for(int i = 0; i < 4; i++) {
+            QVector<BorderHandle> handles;
+            handles.reserve(selected[i].count());
+            for(int s = 0; s < selected[i].count(); s++)
+                handles.push_back(BorderHandle(screen.monitorId(selected[i].at(s).toString()), BorderIndex(i)));
+            screen.setSelectedBorders(BorderIndex(i), handles);
+        }
+
+        return true;
+    }
+
+    /*
+     *
+     * FILES
+     *
+     */
+
+    /// \brief Write the screen to path in the binary format
+    static bool saveBinaryFile(const Screen& screen, const QString& path, QString* error = nullptr) {
+        return save(toBinary(screen), path, error);
+    }
+
+    /// \brief Write the screen to path as an indented JSON document
+    static bool saveJsonFile(const Screen& screen, const QString& path, QString* error = nullptr) {
+        return save(QJsonDocument(toJson(screen)).toJson(QJsonDocument::Indented), path, error);
+    }
+
+    /**
+     * @brief Load a binary or JSON layout file into screen
+     *
+     * Binary files are memory mapped instead of read.
+     * @return true if the layout was loaded; on failure the screen is unchanged
+     */
+    static bool loadFile(Screen& screen, const QString& path, QString* error = nullptr) {
+        QFile file(path);
+        if(!file.open(QFile::ReadOnly))
+            return fail(error, file.errorString());
+
+        const qint64 size = file.size();
+        if(uchar* data = size > 0 ? file.map(0, size) : nullptr) {
+            bool loaded;
+            // BINARY_MAGIC is a pointer, compare the size of the header field
+            const size_t magicSize = sizeof(BinaryHeader::magic);
+            if(size >= qint64(magicSize) && memcmp(data, BINARY_MAGIC, magicSize) == 0)
+                loaded = fromBinary(screen, data, size, error);
+            else
+                loaded = fromJsonData(screen, QByteArray::fromRawData(reinterpret_cast<const char*>(data), int(size)), error);
+            file.unmap(data);
+            return loaded;
+        }
+
+        // mapping is not supported for every file, e.g. in resources
+        const QByteArray data = file.readAll();
+        if(data.startsWith(BINARY_MAGIC))
+            return fromBinary(screen, data, error);
+        return fromJsonData(screen, data, error);
+    }
+
+private:
+    static constexpr const char* BINARY_MAGIC = "SCWL";
+
+    /// \brief Binary file header, followed by the monitor records, the selections and the string table
+    struct BinaryHeader {
+        char magic[4];///< "SCWL"
+        quint32 version;///< BINARY_VERSION
+        quint32 headerSize;///< sizeof(BinaryHeader)
+        quint32 monitorCount;///< number of BinaryMonitor records
+        quint32 selectedCount[4];///< number of selected borders per BorderIndex
+        quint32 stringBytes;///< size of the UTF-8 string table
+    };
+
+    /// \brief One monitor; all fields are 32 bit little endian
+    struct BinaryMonitor {
+        quint32 nameOffset;///< name position in the string table
+        quint32 nameLength;///< name length in bytes
+        qint32 width;
+        qint32 height;
+        qint32 xOffset;
+        qint32 yOffset;
+        qint32 verticalLetterboxBarWidth;
+        qint32 horizontalLetterboxBarHeight;
+        quint32 borderColor[4];///< QRgb per BorderIndex
+    };
+
+    static_assert(sizeof(BinaryHeader) == 36, "binary layout header must be packed");
+    static_assert(sizeof(BinaryMonitor) == 48, "binary monitor record must be packed");
+
+    static const char* borderName(BorderIndex i) {
+        switch(i) {
+        case BorderIndex::BOTTOM: return "bottom";
+        case BorderIndex::RIGHT: return "right";
+        case BorderIndex::TOP: return "top";
+        case BorderIndex::LEFT: return "left";
+        }
+        return "";
+    }
+
+    static bool fail(QString* error, const QString& message) {
+        if(error)
+            *error = message;
+        return false;
+    }
+
+    static bool fromJsonData(Screen& screen, const QByteArray& data, QString* error) {
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(data, &parseError);
+        if(parseError.error != QJsonParseError::NoError)
+            return fail(error, parseError.errorString());
+        if(!document.isObject())
+            return fail(error, "JSON layout is not an object");
+        return fromJson(screen, document.object(), error);
+    }
+
+    static bool save(const QByteArray& data, const QString& path, QString* error) {
+        QSaveFile file(path);
+        if(!file.open(QFile::WriteOnly) || file.write(data) != data.size() || !file.commit())
+            return fail(error, file.errorString());
+        return true;
+    }
+};
+
+}
+
+#endif // LAYOUTSERIALIZER_H
@@ -12,10 +12,41 @@
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QFormLayout>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QPixmap>
+#include <QRegion>
+#include <QStaticText>
+#include <QTimer>
+#include <QSignalBlocker>
+#include <QUndoStack>
 
 #include <assert.h>
+#include <limits>
+#include <memory>
+#include <type_traits>
 #include <stdexcept>
-#include <list>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cmath>
+
+// define SCREENCONFIGWIDGET_NO_SIMD to build the scalar fallbacks, e.g. to test them against the vector code
+#if !defined(SCREENCONFIGWIDGET_NO_SIMD)
+#if defined(__AVX2__)
+#define SCREENCONFIGWIDGET_HAVE_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCREENCONFIGWIDGET_HAVE_SSE2
+#endif
+#endif
+
+#if defined(SCREENCONFIGWIDGET_HAVE_AVX2)
+#include <immintrin.h>
+#elif defined(SCREENCONFIGWIDGET_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
 
 namespace ScreenConfigWidget {
 
@@ -26,6 +57,69 @@ enum struct BorderIndex {
     LEFT = 3
 };
 
+/// \brief Signed desktop position or extent in pixels; monitors left of or above the primary one have negative offsets
+typedef qint32 Coordinate;
+
+/**
+ * @brief Exact integer math on Coordinate values
+ *
+ * Arguments are widened to 64 bit, so intermediate results cannot overflow; a result that does not fit
+ * a Coordinate throws std::overflow_error.
+ */
+namespace CoordinateMath {
+
+/// \brief True if v can be stored in a Coordinate
+constexpr bool fits(qint64 v) {
+    return v >= std::numeric_limits<Coordinate>::min() && v <= std::numeric_limits<Coordinate>::max();
+}
+
+/// \brief v as a Coordinate, throws std::overflow_error if it does not fit
+constexpr Coordinate checked(qint64 v) {
+    return fits(v) ? Coordinate(v) : throw std::overflow_error("coordinate out of range");
+}
+
+constexpr Coordinate add(qint64 a, qint64 b) {
+    return checked(a + b);
+}
+
+constexpr Coordinate sub(qint64 a, qint64 b) {
+    return checked(a - b);
+}
+
+}
+
+/**
+ * @brief A scale factor in fixed point, to scale coordinates without floating point math
+ *
+ * The double is converted once, to a multiple of 1 / 2^24. apply() then rounds like qRound(), which QPoint * double
+ * uses: halves round up, also for negative values (-2.5 becomes -2). The result equals qRound(v * quantized factor);
+ * it may differ by one from QPoint * double where v * factor is within the quantization error of a half. The relative
+ * error of the factor grows at small scales, e.g. 0.001 is stored as 16777 / 2^24.
+ */
+struct FixedScale {
+    static const int FRACTION_BITS = 24;///< resolution of the factor, 1 / 2^24
+    static constexpr qint64 ONE = qint64(1) << FRACTION_BITS;///< the fixed point representation of 1
+    static constexpr double MAX_FACTOR = 64;///< larger factors could overflow the 64 bit products in apply()
+
+    /// \brief Implicit, so functions taking a FixedScale also accept a double
+    constexpr FixedScale(double factor = 1.0) :
+        fixed(factor > 0 && factor <= MAX_FACTOR ? qint64(factor * ONE + 0.5) : throw std::invalid_argument("scale out of range")) {
+    }
+
+    /// \brief v * factor, rounded half up like qRound(); throws std::overflow_error if the result does not fit a Coordinate
+    constexpr Coordinate apply(Coordinate v) const {
+        return CoordinateMath::checked(floorShift(qint64(v) * fixed + ONE / 2));
+    }
+
+    qint64 fixed;///< factor * ONE
+
+private:
+    /// \brief floor(q / ONE); right shifts of negative values are implementation defined before C++20
+    static constexpr qint64 floorShift(qint64 q) {
+        return q >= 0 ? q >> FRACTION_BITS : -((-q + ONE - 1) >> FRACTION_BITS);
+    }
+};
+
 template <typename T>
 /**
  * @brief A helper struct for specifying screen dimensions
@@ -34,43 +128,160 @@ struct Dimensions {
     /**
      * @brief Create a Dimensions struct with the specified values
      */
-    Dimensions(T w, T h, T xOff = 0, T yOff = 0) : width(w), height(h), xOffset(xOff), yOffset(yOff) {
+    constexpr Dimensions(T w, T h, T xOff = 0, T yOff = 0) : width(w), height(h), xOffset(xOff), yOffset(yOff) {
     }
 
     /// \brief create a zero-initialized Dimensions struct \overload
-    Dimensions() {}
+    constexpr Dimensions() {}
 
     T width = 0;///< object width
     T height = 0;///< object height
     T xOffset = 0;///< object horizontal offset
     T yOffset = 0;///< object vertical offset
 
-    T left() const {
+    constexpr T left() const {
         return xOffset;
     }
-    T xOff() const {
+    constexpr T xOff() const {
         return xOffset;
     }
-    T top() const {
+    constexpr T top() const {
         return yOffset;
     }
-    T yOff() const {
+    constexpr T yOff() const {
         return yOffset;
     }
-    T right() const {
+    constexpr T right() const {
         return xOffset + width;
     }
-    T bottom() const {
+    constexpr T bottom() const {
         return yOffset + height;
     }
 
-    QRect qRect(double scale = 1) const {
-        return QRect(QPoint(left(), top()) * scale, QSize(width, height) * scale);
+    /// \brief Offset and size scaled separately, in integer math
+    QRect qRect(FixedScale scale = FixedScale()) const {
+        return QRect(scale.apply(left()), scale.apply(top()), scale.apply(width), scale.apply(height));
     }
 };
 
 /// \brief Typedef for default geometry data type
-typedef Dimensions<size_t> Geometry;
+typedef Dimensions<Coordinate> Geometry;
+
+/// \brief Stable identifier of a monitor inside a Screen, never reused
+typedef quint32 MonitorId;
+
+/// \brief MonitorId value that never belongs to a monitor
+const MonitorId INVALID_MONITOR_ID = 0;
+
+/**
+ * @brief Stable reference to a single border of a monitor
+ */
+struct BorderHandle {
+    MonitorId monitor = INVALID_MONITOR_ID;///< monitor the border belongs to
+    BorderIndex border = BorderIndex::BOTTOM;///< which border of the monitor
+
+    BorderHandle() {}
+    BorderHandle(MonitorId m, BorderIndex b) : monitor(m), border(b) {}
+
+    bool isValid() const {
+        return monitor != INVALID_MONITOR_ID;
+    }
+
+    bool operator==(const BorderHandle& other) const {
+        return monitor == other.monitor && border == other.border;
+    }
+};
+
+/**
+ * @brief Counters describing the cost of Screen::snap
+ */
+struct SnapStatistics {
+    quint64 snapCalls = 0;///< number of snap() calls
+    quint64 candidatesTested = 0;///< number of monitors tested for alignment or collisions, summed over all calls
+    int lastCandidateCount = 0;///< number of monitors tested for alignment or collisions in the last call
+};
+
+/**
+ * @brief Chooses the snap position on one axis: the offered position nearest to the desired one, within a threshold
+ *
+ * Ties go to the smaller position, so the result does not depend on the order positions are offered in.
+ */
+class SnapAxis {
+public:
+    SnapAxis(Coordinate desired, double threshold) : mDesired(desired), mThreshold(threshold) {
+    }
+
+    void offer(qint64 position) {
+        const qint64 distance = qAbs(position - mDesired);
+        if(distance > mThreshold || !CoordinateMath::fits(position))
+            return;
+
+        if(!mFound || distance < mDistance || (distance == mDistance && position < mBest)) {
+            mFound = true;
+            mBest = Coordinate(position);
+            mDistance = distance;
+        }
+    }
+
+    /**
+     * @brief Offer all alignments of a moved interval of length size to the interval [begin, end)
+     *
+     * Aligns begins, ends and centers, and places the moved interval right before or after.
+     */
+    void offerInterval(qint64 begin, qint64 end, qint64 size) {
+        offer(begin);
+        offer(end - size);
+        offer(begin - size);
+        offer(end);
+        offer((begin + end) / 2 - size / 2);
+    }
+
+    /// \brief The chosen position, or the desired one if nothing was offered within the threshold
+    Coordinate result() const {
+        return mFound ? mBest : mDesired;
+    }
+
+private:
+    Coordinate mDesired;///< position without snapping
+    double mThreshold;///< maximum distance of a snap position to mDesired
+    bool mFound = false;///< a position within the threshold was offered
+    Coordinate mBest = 0;///< nearest position offered so far
+    qint64 mDistance = 0;///< distance of mBest to mDesired
+};
+
+/**
+ * @brief One change of a Screen, as delivered to ScreenObserver
+ */
+struct ScreenChange {
+    enum Type {
+        MonitorAdded,
+        MonitorRemoved,
+        MonitorMoved,
+        MonitorResized,
+        LetterboxChanged,
+        BorderSelected,
+        BorderDeselected,
+        SelectionChanged,///< the selected monitor changed; monitor is the new selection, or INVALID_MONITOR_ID
+        Cleared///< all monitors were removed by Screen::clear(), e.g. to load a layout; follows their MonitorRemoved changes
+    };
+
+    Type type = MonitorAdded;///< what changed
+    MonitorId monitor = INVALID_MONITOR_ID;///< the changed monitor, the monitor of the changed border, or the new selection
+    BorderIndex border = BorderIndex::BOTTOM;///< the changed border, for BorderSelected and BorderDeselected
+    QPoint offsetDelta;///< offset change in pixels, for MonitorMoved
+    QSize sizeDelta;///< size change in pixels for MonitorResized; letterbox bar width and height change for LetterboxChanged
+};
+
+/**
+ * @brief Receives the changes of a Screen as they happen
+ */
+class ScreenObserver {
+public:
+    virtual ~ScreenObserver() {}
+
+    /// \brief Called after change was applied to the screen
+    virtual void screenChanged(const ScreenChange& change) = 0;
+};
 
 /**
  * @brief Specify the current mode:
@@ -96,7 +307,7 @@ struct Border {
     QColor drawColor = Qt::GlobalColor::lightGray;///< the color this border should be drawn in, default to grey
 
     /// \brief Create a (possibly scaled) QRect representation of this border for easy drawing
-    QRect qRect(double scale = 1) const {
+    QRect qRect(FixedScale scale = FixedScale()) const {
         QRect r = geometry.qRect(scale);
 
         if(r.width() < 2)
@@ -109,148 +320,408 @@ struct Border {
     }
 };
 
+/**
+ * @brief A read-only view of contiguous borders, e.g. the selected borders of one BorderIndex
+ *
+ * The view does not own the borders. Screen::selectedBorderView() points it at copies the screen caches,
+ * which stay valid until the screen's borderGeneration() changes.
+ */
+class BorderView {
+public:
+    typedef const Border* const_iterator;
+
+    BorderView() {}
+    BorderView(const Border* first, int size) : mFirst(first), mSize(size) {}
+
+    const Border* begin() const { return mFirst; }
+    const Border* end() const { return mFirst + mSize; }
+    int size() const { return mSize; }
+    bool isEmpty() const { return mSize == 0; }
+
+    const Border& operator[](int i) const {
+        assert(i >= 0 && i < mSize);
+        return mFirst[i];
+    }
+
+private:
+    const Border* mFirst = nullptr;
+    int mSize = 0;
+};
+
 /*
  *
  *
  *
  *
  * *************************************************************************************************************************************************
- * Monitor
+ * SPATIAL GRID
  * *************************************************************************************************************************************************
  *
  *
  *
  *
  */
-struct Monitor {
-    QRect boundingRectangle(double scale = 1.0) const {
-        return QRect(top.qRect(scale).topLeft(), bottom.qRect(scale).bottomRight());
+/**
+ * @brief Uniform grid over rectangles, used to find hit-test candidates without scanning all monitors
+ *
+ * Each rectangle is registered in every cell it overlaps. Cell contents are kept sorted by id, so
+ * candidates are reported in the order the monitors were added.
+ */
+class SpatialGrid {
+public:
+    explicit SpatialGrid(int cellSize = 32) : mCellSize(cellSize) {
+        assert(cellSize > 0);
     }
 
-    Monitor(const QString name, size_t width, size_t height,
-            size_t xOffset, size_t yOffset,
-            size_t letterboxOffsetX, size_t letterboxOffsetY) :
-        mName(name),
-        mWidth(width), mHeight(height),
-        mXOffset(xOffset), mYOffset(yOffset),
-        mVerticalLetterboxBarWidth(letterboxOffsetX), mHorizontalLetterboxBarHeight(letterboxOffsetY) {
-        updateGeometry();
-    }
+    /// \brief Register or move the rectangle of id
+    void update(MonitorId id, const QRect& rect) {
+        const QRect cells = cellRange(rect);
 
-    void updateGeometry() {
-        left.geometry = Geometry(
-                            BORDER_WIDTH, //width
-                            mHeight - 2 * BORDER_WIDTH - (2 * mHorizontalLetterboxBarHeight), //height
-                            mVerticalLetterboxBarWidth + mXOffset + 0, //x offset
-                            mHorizontalLetterboxBarHeight + mYOffset + BORDER_WIDTH);// y offset
+        // nothing to do if the rectangle still covers the same cells
+        auto known = mCellRanges.find(id);
+        if(known != mCellRanges.end() && known.value() == cells)
+            return;
 
-        right.geometry = Geometry(
-                             BORDER_WIDTH, //width
-                             mHeight - 2 * BORDER_WIDTH - (2 * mHorizontalLetterboxBarHeight), //height
-                             (-mVerticalLetterboxBarWidth) + mXOffset + mWidth - BORDER_WIDTH, //x offset
-                             mHorizontalLetterboxBarHeight + mYOffset + BORDER_WIDTH);// y offset
+        remove(id);
 
-        top.geometry = Geometry(
-                           mWidth - (2 * mVerticalLetterboxBarWidth), //width
-                           BORDER_WIDTH, //height
-                           mVerticalLetterboxBarWidth + mXOffset + 0, //x offset
-                           mHorizontalLetterboxBarHeight + mYOffset + 0);// y offset
+        for(int cy = cells.top(); cy <= cells.bottom(); cy++) {
+            for(int cx = cells.left(); cx <= cells.right(); cx++) {
+                QVector<MonitorId>& cell = mCells[cellKey(cx, cy)];
+                cell.insert(std::lower_bound(cell.begin(), cell.end(), id), id);
+            }
+        }
 
-        bottom.geometry = Geometry(
-                              mWidth - (2 * mVerticalLetterboxBarWidth), //width
-                              BORDER_WIDTH, //height
-                              mVerticalLetterboxBarWidth + mXOffset + 0, //x offset
-                              (-mHorizontalLetterboxBarHeight) + mYOffset + mHeight - BORDER_WIDTH);// y offset
+        mCellRanges.insert(id, cells);
     }
 
-    /**
-     * @brief Retrieve border
-     * @param i 0:bottom, 1:right, 2:top, 3:left
-     */
-    const Border& operator[] (size_t i) const {
-        switch(i) {
-        case 0:
-            return bottom;
-        case 1:
-            return right;
-        case 2:
-            return top;
-        case 3:
-            return left;
-        default:
-            throw std::invalid_argument("index out of range 0-3");
+    /// \brief Unregister id
+    void remove(MonitorId id) {
+        auto known = mCellRanges.find(id);
+        if(known == mCellRanges.end())
+            return;
+
+        const QRect cells = known.value();
+        for(int cy = cells.top(); cy <= cells.bottom(); cy++) {
+            for(int cx = cells.left(); cx <= cells.right(); cx++) {
+                auto cell = mCells.find(cellKey(cx, cy));
+                if(cell == mCells.end())
+                    continue;
+
+                cell.value().removeOne(id);
+                if(cell.value().isEmpty())
+                    mCells.erase(cell);
+            }
         }
+
+        mCellRanges.erase(known);
+    }
+
+    void clear() {
+        mCells.clear();
+        mCellRanges.clear();
+    }
+
+    int cellSize() const {
+        return mCellSize;
+    }
+
+    /// \brief Change the cell edge length; unregisters all ids, so they have to be updated again
+    void setCellSize(int cellSize) {
+        assert(cellSize > 0);
+        clear();
+        mCellSize = cellSize;
     }
 
     /**
-     * @brief Retrieve border
-     * @param i 0:bottom, 1:right, 2:top, 3:left
+     * @brief Collect all ids whose rectangle may overlap rect
+     * @param out receives the ids in ascending order, without duplicates
      */
-    Border& operator[] (size_t i) {
-        switch(i) {
-        case 0:
-            return bottom;
-        case 1:
-            return right;
-        case 2:
-            return top;
-        case 3:
-            return left;
-        default:
-            throw std::invalid_argument("index out of range 0-3");
+    void candidates(const QRect& rect, QVector<MonitorId>& out) const {
+        out.clear();
+        const QRect cells = cellRange(rect);
+
+        // walk whichever is smaller: the covered cells or the occupied cells
+        const qint64 coveredCells = qint64(cells.width()) * cells.height();
+        if(coveredCells <= mCells.size()) {
+            for(int cy = cells.top(); cy <= cells.bottom(); cy++) {
+                for(int cx = cells.left(); cx <= cells.right(); cx++) {
+                    auto cell = mCells.find(cellKey(cx, cy));
+                    if(cell != mCells.end())
+                        out += cell.value();
+                }
+            }
+        } else {
+            for(auto range = mCellRanges.begin(); range != mCellRanges.end(); ++range)
+                if(range.value().intersects(cells))
+                    out.append(range.key());
         }
+
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
     }
 
-    const QString& getName() const {
-        return mName;
+    /// \brief All ids whose rectangle may contain pos, in ascending order
+    const QVector<MonitorId>& candidates(const QPoint& pos) const {
+        static const QVector<MonitorId> empty;
+        auto cell = mCells.find(cellKey(cellCoordinate(pos.x()), cellCoordinate(pos.y())));
+        return cell == mCells.end() ? empty : cell.value();
     }
 
-    QString getName() {
-        return mName;
+private:
+    /// \brief floor(v / mCellSize), also for negative coordinates
+    int cellCoordinate(int v) const {
+        return v >= 0 ? v / mCellSize : -((-v - 1) / mCellSize) - 1;
     }
 
-    void setPosition(const QPoint& targetPosition) {
-        // calculate the delta (-> target - current) to the position of the monitor, so we can reuse move()
-        move(targetPosition - boundingRectangle().topLeft());
+    /// \brief The inclusive range of cells covered by rect
+    QRect cellRange(const QRect& rect) const {
+        return QRect(QPoint(cellCoordinate(rect.left()), cellCoordinate(rect.top())),
+                     QPoint(cellCoordinate(rect.right()), cellCoordinate(rect.bottom())));
     }
 
-    void move(const QPoint& delta) {
-        setXOffset(xOffset() + delta.x());
-        setYOffset(yOffset() + delta.y());
+    static quint64 cellKey(int cx, int cy) {
+        return (quint64(quint32(cx)) << 32) | quint32(cy);
     }
 
+    int mCellSize;///< edge length of a cell
+    QHash<quint64, QVector<MonitorId>> mCells;///< ids overlapping each non-empty cell
+    QHash<MonitorId, QRect> mCellRanges;///< cells covered by each registered id
+};
+
+/*
+ *
+ *
+ *
+ *
+ * *************************************************************************************************************************************************
+ * BORDER HIT TABLE
+ * *************************************************************************************************************************************************
+ *
+ *
+ *
+ *
+ */
+/**
+ * @brief Packed border rectangles, tested against points with SSE2/AVX2 where available
+ *
+ * Entry slot * 4 + BorderIndex holds the scaled rectangle of that border of the monitor in slot,
+ * clipped to the monitor's bounding rectangle. Coordinates are inclusive, like QRect. The arrays
+ * are padded with empty rectangles to a multiple of LANES entries.
+ */
+class BorderHitTable {
 public:
-    size_t width() const { return mWidth; } ///< screen geometry in pixels
-    size_t height() const { return mHeight; } ///< screen geometry in pixels
-    size_t xOffset() const { return mXOffset; } ///< screen offset in pixels
-    size_t yOffset() const { return mYOffset; } ///< screen offset in pixels
-    size_t verticalLetterboxBarWidth() const { return mVerticalLetterboxBarWidth; } ///< the height of the horizontal letterbox bars
-    size_t horizontalLetterboxBarHeight() const { return mHorizontalLetterboxBarHeight; } ///< the width of the vertical letterbox bars
-
-    void setWidth(size_t width) { mWidth = width; updateGeometry(); } ///< set screen geometry in pixels
-    void setHeight(size_t height) { mHeight = height; updateGeometry(); } ///< set screen geometry in pixels
-    void setXOffset(size_t xOff) { mXOffset = xOff; updateGeometry(); } ///< set screen offset in pixels
-    void setYOffset(size_t yOff) { mYOffset = yOff; updateGeometry(); } ///< set screen offset in pixels
-    void setVerticalLetterboxBarWidth(size_t vlbw) { mVerticalLetterboxBarWidth = vlbw; updateGeometry(); } ///< set the height of the horizontal letterbox bars
-    void setHorizontalLetterboxBarHeight(size_t hlbw) { mHorizontalLetterboxBarHeight = hlbw; updateGeometry(); } ///< set the width of the vertical letterbox bars
+    static const int LANES = 8;///< widest vector the arrays are padded for
+
+    /// \brief Number of valid entries, four per slot
+    int entryCount() const {
+        return mEntries;
+    }
+
+    /// \brief Add four empty entries for a new slot at the end
+    void appendSlot() {
+        mEntries += 4;
+        pad();
+    }
+
+    /// \brief Remove the entries of slot, moving all later slots down by one
+    void removeSlot(int slot) {
+        assert(slot >= 0 && slot * 4 < mEntries);
+        const int first = slot * 4;
+        for(std::vector<qint32>* a : {&mLeft, &mTop, &mRight, &mBottom})
+            a->erase(a->begin() + first, a->begin() + first + 4);
+        mEntries -= 4;
+        pad();
+    }
+
+    void setRect(int slot, BorderIndex border, const QRect& rect) {
+        const int e = slot * 4 + int(border);
+        assert(e < mEntries);
+        mLeft[e] = rect.left();
+        mTop[e] = rect.top();
+        mRight[e] = rect.right();
+        mBottom[e] = rect.bottom();
+    }
+
+    /// \brief Index of the first border of slot containing pos, or -1
+    int findInSlot(int slot, const QPoint& pos) const {
+        const int first = slot * 4;
+#if defined(SCREENCONFIGWIDGET_HAVE_SSE2)
+        const __m128i x = _mm_set1_epi32(pos.x());
+        const __m128i y = _mm_set1_epi32(pos.y());
+        const int inside = ~outsideMask(first, x, y) & 0xF;
+        return inside ? firstSetBit(inside) : -1;
+#else
+        for(int e = first; e < first + 4; e++)
+            if(contains(e, pos))
+                return e - first;
+        return -1;
+#endif
+    }
+
+    /// \brief Index of the first entry containing pos, or -1
+    int find(const QPoint& pos) const {
+#if defined(SCREENCONFIGWIDGET_HAVE_AVX2)
+        const __m256i x = _mm256_set1_epi32(pos.x());
+        const __m256i y = _mm256_set1_epi32(pos.y());
+        for(int e = 0; e < mEntries; e += 8) {
+            const __m256i outside = _mm256_or_si256(
+                                        _mm256_or_si256(_mm256_cmpgt_epi32(load8(mLeft, e), x), _mm256_cmpgt_epi32(x, load8(mRight, e))),
+                                        _mm256_or_si256(_mm256_cmpgt_epi32(load8(mTop, e), y), _mm256_cmpgt_epi32(y, load8(mBottom, e))));
+            const int inside = ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF;
+            if(inside)
+                return e + firstSetBit(inside);
+        }
+        return -1;
+#elif defined(SCREENCONFIGWIDGET_HAVE_SSE2)
+        const __m128i x = _mm_set1_epi32(pos.x());
+        const __m128i y = _mm_set1_epi32(pos.y());
+        for(int e = 0; e < mEntries; e += 4) {
+            const int inside = ~outsideMask(e, x, y) & 0xF;
+            if(inside)
+                return e + firstSetBit(inside);
+        }
+        return -1;
+#else
+        for(int e = 0; e < mEntries; e++)
+            if(contains(e, pos))
+                return e;
+        return -1;
+#endif
+    }
+
+    /// \brief find() for a batch of points \overload
+    void find(const QPoint* points, int count, int* entries) const {
+        for(int i = 0; i < count; i++)
+            entries[i] = find(points[i]);
+    }
 
 private:
-    QString mName;///< the identification of this monitor
+    bool contains(int e, const QPoint& pos) const {
+        return mLeft[e] <= pos.x() && pos.x() <= mRight[e] && mTop[e] <= pos.y() && pos.y() <= mBottom[e];
+    }
+
+    static int firstSetBit(int mask) {
+        int bit = 0;
+        while(!(mask & (1 << bit)))
+            bit++;
+        return bit;
+    }
+
+#if defined(SCREENCONFIGWIDGET_HAVE_SSE2)
+    /// \brief Bit i is set if entry first + i does not contain (x, y)
+    int outsideMask(int first, __m128i x, __m128i y) const {
+        const __m128i outside = _mm_or_si128(
+                                    _mm_or_si128(_mm_cmpgt_epi32(load4(mLeft, first), x), _mm_cmpgt_epi32(x, load4(mRight, first))),
+                                    _mm_or_si128(_mm_cmpgt_epi32(load4(mTop, first), y), _mm_cmpgt_epi32(y, load4(mBottom, first))));
+        return _mm_movemask_ps(_mm_castsi128_ps(outside));
+    }
+
+    static __m128i load4(const std::vector<qint32>& a, int first) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data() + first));
+    }
+#endif
+
+#if defined(SCREENCONFIGWIDGET_HAVE_AVX2)
+    static __m256i load8(const std::vector<qint32>& a, int first) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.data() + first));
+    }
+#endif
+
+    /// \brief Grow or shrink the arrays to the padded size; new entries are empty rectangles
+    void pad() {
+        const size_t padded = size_t((mEntries + LANES - 1) / LANES * LANES);
+        mLeft.resize(padded, 0);
+        mTop.resize(padded, 0);
+        mRight.resize(padded, -1);
+        mBottom.resize(padded, -1);
+    }
+
+    int mEntries = 0;///< valid entries
+    std::vector<qint32> mLeft;///< left edge of each entry
+    std::vector<qint32> mTop;///< top edge of each entry
+    std::vector<qint32> mRight;///< right edge of each entry (inclusive)
+    std::vector<qint32> mBottom;///< bottom edge of each entry (inclusive)
+};
+
+/**
+ * @brief A set of monitor geometry changes, applied with a single geometry update by Monitor::apply
+ */
+struct GeometryUpdate {
+    /// \brief Flags for the fields contained in an update
+    enum Field {
+        Width = 1 << 0,
+        Height = 1 << 1,
+        XOffset = 1 << 2,
+        YOffset = 1 << 3,
+        VerticalLetterboxBarWidth = 1 << 4,
+        HorizontalLetterboxBarHeight = 1 << 5
+    };
+
+    GeometryUpdate& setWidth(Coordinate v) { width = v; fields |= Width; return *this; }
+    GeometryUpdate& setHeight(Coordinate v) { height = v; fields |= Height; return *this; }
+    GeometryUpdate& setXOffset(Coordinate v) { xOffset = v; fields |= XOffset; return *this; }
+    GeometryUpdate& setYOffset(Coordinate v) { yOffset = v; fields |= YOffset; return *this; }
+    GeometryUpdate& setVerticalLetterboxBarWidth(Coordinate v) { verticalLetterboxBarWidth = v; fields |= VerticalLetterboxBarWidth; return *this; }
+    GeometryUpdate& setHorizontalLetterboxBarHeight(Coordinate v) { horizontalLetterboxBarHeight = v; fields |= HorizontalLetterboxBarHeight; return *this; }
+
+    bool contains(Field f) const {
+        return fields & f;
+    }
 
-    Border bottom, right, top, left;///< border geometry and selection state
+    /// \brief Set a single field \overload
+    GeometryUpdate& set(Field f, Coordinate v) {
+        switch(f) {
+        case Width: return setWidth(v);
+        case Height: return setHeight(v);
+        case XOffset: return setXOffset(v);
+        case YOffset: return setYOffset(v);
+        case VerticalLetterboxBarWidth: return setVerticalLetterboxBarWidth(v);
+        case HorizontalLetterboxBarHeight: return setHorizontalLetterboxBarHeight(v);
+        }
+        return *this;
+    }
 
-    size_t mWidth;///< screen geometry in pixels
-    size_t mHeight;///< screen geometry in pixels
-    size_t mXOffset;///< screen offset in pixels
-    size_t mYOffset;///< screen offset in pixels
-    size_t mVerticalLetterboxBarWidth;///< the height of the horizontal letterbox bars
-    size_t mHorizontalLetterboxBarHeight;///< the width of the vertical letterbox bars
+    /// \brief Value of a single field, 0 if it is not contained
+    Coordinate value(Field f) const {
+        if(!contains(f))
+            return 0;
+
+        switch(f) {
+        case Width: return width;
+        case Height: return height;
+        case XOffset: return xOffset;
+        case YOffset: return yOffset;
+        case VerticalLetterboxBarWidth: return verticalLetterboxBarWidth;
+        case HorizontalLetterboxBarHeight: return horizontalLetterboxBarHeight;
+        }
+        return 0;
+    }
 
+    int fields = 0;///< combination of Field flags present in this update
+    Coordinate width = 0;///< new screen width, if Width is set
+    Coordinate height = 0;///< new screen height, if Height is set
+    Coordinate xOffset = 0;///< new horizontal offset, if XOffset is set
+    Coordinate yOffset = 0;///< new vertical offset, if YOffset is set
+    Coordinate verticalLetterboxBarWidth = 0;///< new vertical letterbox bar width, if VerticalLetterboxBarWidth is set
+    Coordinate horizontalLetterboxBarHeight = 0;///< new horizontal letterbox bar height, if HorizontalLetterboxBarHeight is set
+};
 
+/**
+ * @brief A monitor to be placed by the layout generators of Screen
+ */
+struct MonitorSpec {
+    MonitorSpec(const QString& n = QString(), Coordinate w = 0, Coordinate h = 0, Coordinate vlbw = 0, Coordinate hlbh = 0) :
+        name(n), width(w), height(h), verticalLetterboxBarWidth(vlbw), horizontalLetterboxBarHeight(hlbh) {
+    }
 
-    const size_t BORDER_WIDTH = 16;///< how wide each border should be
+    QString name;///< unique monitor name
+    Coordinate width;///< screen geometry in pixels, including letterbox bars
+    Coordinate height;///< screen geometry in pixels, including letterbox bars
+    Coordinate verticalLetterboxBarWidth;///< width of the vertical letterbox bars, e.g. to compensate bezels
+    Coordinate horizontalLetterboxBarHeight;///< height of the horizontal letterbox bars, e.g. to compensate bezels
 };
 
+class Screen;
 
 /*
  *
@@ -258,273 +729,1608 @@ private:
  *
  *
  * *************************************************************************************************************************************************
- * SCREEN
+ * Monitor
  * *************************************************************************************************************************************************
  *
  *
  *
  *
  */
-class Screen {
-    std::list<Monitor> mMonitorList; ///< list of all the known monitors
-    double mScale = 1.0 / 10.0;
-
-    bool monitorExists(const QString& name) {
-        bool exists = false;
-
-        for(auto& m : mMonitorList)
-            if(m.getName() == name)
-                exists = true;
+struct Monitor {
+    /// \brief Bounding rectangle of the borders; cached for scale 1 and for the last scale asked for
+    QRect boundingRectangle(double scale = 1.0) const {
+        return rects(scale).bounds;
+    }
 
-        return exists;
+    /// \brief Equivalent to (*this)[i].qRect(scale), but cached like boundingRectangle()
+    QRect borderRect(BorderIndex i, double scale = 1.0) const {
+        return rects(scale).borders[int(i)];
     }
 
-    Monitor* getMonitor(const QString& name){
-        for(auto& m : mMonitorList)
-            if(m.getName() == name)
-                return &m;
-        return nullptr;
+    Monitor(const QString name, Coordinate width, Coordinate height,
+            Coordinate xOffset, Coordinate yOffset,
+            Coordinate letterboxOffsetX, Coordinate letterboxOffsetY) :
+        mName(name),
+        mWidth(width), mHeight(height),
+        mXOffset(xOffset), mYOffset(yOffset),
+        mVerticalLetterboxBarWidth(letterboxOffsetX), mHorizontalLetterboxBarHeight(letterboxOffsetY) {
+        updateGeometry();
     }
 
-    Monitor* mCurrentMonitorSelection = nullptr;
+    /// \brief Copies belong to no Screen: they have no id, and their setters do not touch the original's Screen
+    Monitor(const Monitor&) = default;
 
-public:
-    const Monitor* currentlySelectedMonitor() {
-        return mCurrentMonitorSelection;
-    }
+    /// \brief Copy the values of other; this monitor leaves its Screen, like a copy constructed one \overload
+    Monitor& operator=(const Monitor&) = default;
 
-    void drawText(QPainter& painter, const Monitor& m) {
-        QRect bounding = m.boundingRectangle();
-        painter.drawText(
-            m.boundingRectangle(mScale),
-            Qt::AlignCenter,
-            QString("%1\n%2x%3\n%4+%5")
-            .arg(m.getName())
-            .arg(bounding.width())
-            .arg(bounding.height())
-            .arg(bounding.left())
-            .arg(bounding.top()));
-    }
-
-    void drawBorders(QPainter& painter) {
-        // draw all monitors
-        for(const Monitor& monitor : mMonitorList) {
-            // draw all borders
-            for(size_t i = 0; i < 4; i++) {
-                // draw a scaled down version of the borders
-                painter.fillRect(monitor[i].qRect(mScale), monitor[i].drawColor);
-            }
+    /// \brief Moves keep the owning Screen and id, so the Screen can store its monitors in a std::vector
+    Monitor(Monitor&&) = default;
 
-            // draw info text
-            drawText(painter, monitor);
-        }
-    }
+    /// \brief Take over the values, Screen and id of other \overload
+    Monitor& operator=(Monitor&&) = default;
 
-    void drawBoundingRectangle(QPainter& painter) {
-        // draw all monitors
-        for(const Monitor& monitor : mMonitorList) {
-            QColor fillColor;
-            if(&monitor == mCurrentMonitorSelection)
-                fillColor = Qt::GlobalColor::darkGray;
-            else
-                fillColor = Qt::GlobalColor::lightGray;
+    /**
+     * @brief True if a monitor can have the geometry in g
+     *
+     * Sizes and letterbox bars must not be negative, and all edges must be within the Coordinate range.
+     * All fields of g are checked, whether they are contained or not.
+     */
+    static bool isValidGeometry(const GeometryUpdate& g) {
+        return g.width >= 0 && g.height >= 0 && g.verticalLetterboxBarWidth >= 0 && g.horizontalLetterboxBarHeight >= 0
+                && CoordinateMath::fits(qint64(g.xOffset) + g.width) && CoordinateMath::fits(qint64(g.yOffset) + g.height);
+    }
 
-            const QRect rect = monitor.boundingRectangle(mScale);
+    void updateGeometry() {
+        using namespace CoordinateMath;
+        assert(isValidGeometry(geometryFields()) && "invalid monitor geometry");
 
-            // draw a scaled down version of the bounding rectangle
-            painter.fillRect(rect, fillColor);
+        // the borders line the area inside the letterbox bars; they shrink to nothing if the bars leave no room
+        const Coordinate left = add(mXOffset, mVerticalLetterboxBarWidth);
+        const Coordinate top = add(mYOffset, mHorizontalLetterboxBarHeight);
+        const Coordinate innerWidth = std::max(0, sub(mWidth, 2 * qint64(mVerticalLetterboxBarWidth)));
+        const Coordinate innerHeight = std::max(0, sub(mHeight, 2 * qint64(mHorizontalLetterboxBarHeight)));
+        const Coordinate sideHeight = std::max(0, innerHeight - 2 * BORDER_WIDTH);
 
-            // draw info text
-            drawText(painter, monitor);
-        }
-    }
+        mBorders[int(BorderIndex::LEFT)].geometry = Geometry(
+                            BORDER_WIDTH, //width
+                            sideHeight, //height
+                            left, //x offset
+                            add(top, BORDER_WIDTH));// y offset
 
-    void deleteMonitor(const QString& name) {
-        mMonitorList.remove_if([name](Monitor& m) {
-            return m.getName() == name;
-        });
+        mBorders[int(BorderIndex::RIGHT)].geometry = Geometry(
+                             BORDER_WIDTH, //width
+                             sideHeight, //height
+                             sub(add(left, innerWidth), BORDER_WIDTH), //x offset
+                             add(top, BORDER_WIDTH));// y offset
 
-        // if we delete a monitor, the pointer may become invalid
-        mCurrentMonitorSelection = nullptr;
-    }
+        mBorders[int(BorderIndex::TOP)].geometry = Geometry(
+                           innerWidth, //width
+                           BORDER_WIDTH, //height
+                           left, //x offset
+                           top);// y offset
 
-    bool addMonitor(const QString& name, int xRes, int yRes, int xOff = 0, int yOff = 0, int horLetterBox = 0, int verLetterBox = 0) {
-        // allow unique names only
-        if(monitorExists(name))
-            return false;
+        mBorders[int(BorderIndex::BOTTOM)].geometry = Geometry(
+                              innerWidth, //width
+                              BORDER_WIDTH, //height
+                              left, //x offset
+                              sub(add(top, innerHeight), BORDER_WIDTH));// y offset
 
-        // if we add a monitor, the pointer may become invalid
-        mCurrentMonitorSelection = nullptr;
+        // the info text shows size and offset
+        mLabel.width = -1;
+        mGeometryPending = false;
 
-        // add monitor
-        mMonitorList.push_back(Monitor(name, xRes, yRes, xOff, yOff, horLetterBox, verLetterBox));
+        mUnscaledRects = computeRects(1.0);
+        mScaledRects.scale = 0;
 
-        // return true
-        return true;
+        // let the owning screen know about the new geometry
+        notifyGeometryChanged();
     }
 
-    void moveMonitors(Monitor* mon, const QPoint& target, const QPoint& source, const QRect& bounding) {
-        if(mon){
-            mCurrentMonitorSelection = mon;
-            snap(*mon, target, source, bounding);
-        }
+    /**
+     * @brief Retrieve border
+     * @param i 0:bottom, 1:right, 2:top, 3:left
+     */
+    const Border& operator[] (size_t i) const {
+        assert(i < 4 && "index out of range 0-3");
+        return mBorders[i];
     }
 
     /**
-     * @brief Snap monitor to points of interest instead of straight moving
+     * @brief Retrieve border
+     * @param i 0:bottom, 1:right, 2:top, 3:left
      */
-    void snap(Monitor& snapping, const QPoint& target, const QPoint& /*source*/, const QRect& masterBounding) {
-        QRect snappingRect = snapping.boundingRectangle();
-        QRect snappingRectMoved(snappingRect);
-        snappingRectMoved.moveTo(target / mScale);
-
-        // this would probably be the way to move by delta, if i could figure out how tf to get it working
-        //QRect monMoved = mon.translated((target - source));
-
-        // poi: a) within rectangle  b) to main border  c) to other monitors
-
-        // POI b) snap to main border
-        double heightTreshold = .05 * masterBounding.height();
-        double widthTreshold = .05 * masterBounding.width();
-
-        /*
-         *
-         * MAIN BORDER SNAPPING
-         *
-         */
-
-        // stay greater equal zero
-        if(snappingRectMoved.left() < widthTreshold)
-            snappingRectMoved.moveLeft(0);
-
-        if(snappingRectMoved.top() < heightTreshold)
-            snappingRectMoved.moveTop(0);
-
-        // stay smaller equal maximum
-        if((masterBounding.right() / mScale - snappingRectMoved.right()) < widthTreshold)
-            snappingRectMoved.moveRight(masterBounding.right() / mScale);
-
-        if((masterBounding.bottom() / mScale - snappingRectMoved.bottom()) < heightTreshold)
-            snappingRectMoved.moveBottom(masterBounding.bottom() / mScale);
-
-        /*
-         *
-         * OTHER MONITOR SNAPPING
-         *
-         */
-
-        for(const Monitor& other : mMonitorList) {
-            // we are only interested in the other monitors
-            if(other.getName() == snapping.getName()) continue;
-            QRect otherRect = other.boundingRectangle();
-            // enlarge the other monitors rectangle to check for near collisions
-            QRect otherTestRect = otherRect.adjusted(-widthTreshold / 2, -heightTreshold / 2, widthTreshold / 2, heightTreshold / 2);
-
-            // check for collision...
-            if(otherTestRect.intersects(snappingRectMoved)) {
-                QRect intersection = otherTestRect.intersected(snappingRectMoved);
-                // the intersection occured when moving right to left or vice versa
-                if(intersection.height() > intersection.width()) {
-                    // moving monitor is to the right
-                    if(snappingRectMoved.right() > otherRect.right())
-                        snappingRectMoved.moveLeft(otherRect.right() + 1);
-                    // moving monitor is to the left
-                    else if (snappingRectMoved.right() < otherRect.right())
-                        snappingRectMoved.moveRight(otherRect.left() - 0);
-                }
-                // the intersection occured when moving top to down or vice versa
-                else {
-                    // moving monitor is to the top
-                    if(snappingRectMoved.top() < otherRect.top())
-                        snappingRectMoved.moveBottom(otherRect.top() - 0);
-                    // moving monitor is to the bottom
-                    else if (snappingRectMoved.top() > otherRect.top())
-                        snappingRectMoved.moveTop(otherRect.bottom() + 1);
-                }
-            }
-        }
+    Border& operator[] (size_t i) {
+        assert(i < 4 && "index out of range 0-3");
+        return mBorders[i];
+    }
+
+    /// \brief Retrieve border \overload
+    const Border& operator[] (BorderIndex i) const {
+        return mBorders[int(i)];
+    }
 
-        snapping.setPosition(snappingRectMoved.topLeft());
+    /// \brief Retrieve border \overload
+    Border& operator[] (BorderIndex i) {
+        return mBorders[int(i)];
     }
 
+    const QString& getName() const {
+        return mName;
+    }
+
+    /**
+     * @brief The info text (name, size, offset) of this monitor, laid out for textWidth
+     *
+     * The layout is cached and only rebuilt when textWidth or the geometry changes.
+     */
+    const QStaticText& label(int textWidth) const {
+        if(!mLabel.text) {
+            mLabel.text.reset(new QStaticText());
+            mLabel.text->setTextFormat(Qt::RichText);
+            mLabel.text->setTextOption(QTextOption(Qt::AlignHCenter));
+        }
+        if(textWidth != mLabel.width) {
+            const QRect bounding = boundingRectangle();
+            mLabel.text->setText(QString("%1<br>%2x%3<br>%4+%5")
+                                 .arg(mName.toHtmlEscaped())
+                                 .arg(bounding.width())
+                                 .arg(bounding.height())
+                                 .arg(bounding.left())
+                                 .arg(bounding.top()));
+            mLabel.text->setTextWidth(textWidth);
+            mLabel.width = textWidth;
+        }
+        return *mLabel.text;
+    }
+
+    /// \brief The id assigned by the owning Screen, or INVALID_MONITOR_ID
+    MonitorId id() const {
+        return mOwner.id;
+    }
+
+    QString getName() {
+        return mName;
+    }
+
+    void setPosition(const QPoint& targetPosition) {
+        // calculate the delta (-> target - current) to the position of the monitor, so we can reuse move()
+        move(targetPosition - boundingRectangle().topLeft());
+    }
+
+    void move(const QPoint& delta) {
+        apply(GeometryUpdate()
+              .setXOffset(CoordinateMath::add(xOffset(), delta.x()))
+              .setYOffset(CoordinateMath::add(yOffset(), delta.y())));
+    }
+
+    /// \brief All geometry fields with their current values
+    GeometryUpdate geometryFields() const {
+        return GeometryUpdate()
+                .setWidth(mWidth)
+                .setHeight(mHeight)
+                .setXOffset(mXOffset)
+                .setYOffset(mYOffset)
+                .setVerticalLetterboxBarWidth(mVerticalLetterboxBarWidth)
+                .setHorizontalLetterboxBarHeight(mHorizontalLetterboxBarHeight);
+    }
+
+    /**
+     * @brief Defer updateGeometry() until the matching endUpdate()
+     *
+     * Calls may nest; the borders are recomputed once when the outermost endUpdate() is reached,
+     * and only if a setter changed a value in between.
+     */
+    void beginUpdate() {
+        mUpdateDepth++;
+    }
+
+    /// \brief End a change set started with beginUpdate()
+    void endUpdate() {
+        assert(mUpdateDepth > 0);
+        if(--mUpdateDepth == 0 && mGeometryPending)
+            updateGeometry();
+    }
+
+    /// \brief Apply all fields of update with a single geometry update; returns true if anything changed
+    bool apply(const GeometryUpdate& update) {
+        bool changed = false;
+
+        beginUpdate();
+        if(update.contains(GeometryUpdate::Width)) changed |= change(mWidth, update.width);
+        if(update.contains(GeometryUpdate::Height)) changed |= change(mHeight, update.height);
+        if(update.contains(GeometryUpdate::XOffset)) changed |= change(mXOffset, update.xOffset);
+        if(update.contains(GeometryUpdate::YOffset)) changed |= change(mYOffset, update.yOffset);
+        if(update.contains(GeometryUpdate::VerticalLetterboxBarWidth)) changed |= change(mVerticalLetterboxBarWidth, update.verticalLetterboxBarWidth);
+        if(update.contains(GeometryUpdate::HorizontalLetterboxBarHeight)) changed |= change(mHorizontalLetterboxBarHeight, update.horizontalLetterboxBarHeight);
+        endUpdate();
+
+        return changed;
+    }
+
+public:
+    Coordinate width() const { return mWidth; } ///< screen geometry in pixels
+    Coordinate height() const { return mHeight; } ///< screen geometry in pixels
+    Coordinate xOffset() const { return mXOffset; } ///< screen offset in pixels
+    Coordinate yOffset() const { return mYOffset; } ///< screen offset in pixels
+    Coordinate verticalLetterboxBarWidth() const { return mVerticalLetterboxBarWidth; } ///< the height of the horizontal letterbox bars
+    Coordinate horizontalLetterboxBarHeight() const { return mHorizontalLetterboxBarHeight; } ///< the width of the vertical letterbox bars
+
+    void setWidth(Coordinate width) { change(mWidth, width); } ///< set screen geometry in pixels
+    void setHeight(Coordinate height) { change(mHeight, height); } ///< set screen geometry in pixels
+    void setXOffset(Coordinate xOff) { change(mXOffset, xOff); } ///< set screen offset in pixels, may be negative
+    void setYOffset(Coordinate yOff) { change(mYOffset, yOff); } ///< set screen offset in pixels, may be negative
+    void setVerticalLetterboxBarWidth(Coordinate vlbw) { change(mVerticalLetterboxBarWidth, vlbw); } ///< set the height of the horizontal letterbox bars
+    void setHorizontalLetterboxBarHeight(Coordinate hlbw) { change(mHorizontalLetterboxBarHeight, hlbw); } ///< set the width of the vertical letterbox bars
+
+private:
+    friend class Screen;
+
+    /// \brief Inform the owning Screen that the border geometry changed; defined after Screen
+    inline void notifyGeometryChanged();
+
+    /// \brief Set a geometry member, updating the borders now or at the end of the current change set
+    bool change(Coordinate& member, Coordinate value) {
+        if(member == value)
+            return false;
+
+        member = value;
+
+        if(mUpdateDepth > 0)
+            mGeometryPending = true;
+        else
+            updateGeometry();
+
+        return true;
+    }
+
+    /// \brief Bounding and border rectangles at one scale
+    struct ScaledRects {
+        double scale = 0;///< the scale the rectangles were computed for, 0 if they are invalid
+        QRect bounds;///< see boundingRectangle()
+        QRect borders[4];///< see borderRect(), indexed by BorderIndex
+    };
+
+    ScaledRects computeRects(double scale) const {
+        const FixedScale fixed(scale);
+        ScaledRects r;
+        r.scale = scale;
+        for(int i = 0; i < 4; i++)
+            r.borders[i] = mBorders[i].qRect(fixed);
+        r.bounds = QRect(r.borders[int(BorderIndex::TOP)].topLeft(), r.borders[int(BorderIndex::BOTTOM)].bottomRight());
+        return r;
+    }
+
+    const ScaledRects& rects(double scale) const {
+        if(scale == 1.0)
+            return mUnscaledRects;
+        if(scale != mScaledRects.scale)
+            mScaledRects = computeRects(scale);
+        return mScaledRects;
+    }
+
+    /// \brief The Screen owning a monitor and the id it assigned; reset by copies, kept by moves
+    struct Owner {
+        Owner() {}
+        Owner(const Owner&) {}
+        Owner(Owner&& other) noexcept : screen(other.screen), id(other.id) {}
+
+        Owner& operator=(const Owner&) {
+            screen = nullptr;
+            id = INVALID_MONITOR_ID;
+            return *this;
+        }
+
+        Owner& operator=(Owner&& other) noexcept {
+            screen = other.screen;
+            id = other.id;
+            return *this;
+        }
+
+        Screen* screen = nullptr;///< the screen owning this monitor, notified on geometry changes
+        MonitorId id = INVALID_MONITOR_ID;///< stable id assigned by the owning Screen
+    };
+
+    /// \brief The cached info text layout; copies start without one, moves take it over
+    struct Label {
+        Label() {}
+        Label(const Label&) {}
+        Label(Label&&) = default;
+
+        Label& operator=(const Label&) {
+            text.reset();
+            width = -1;
+            return *this;
+        }
+
+        Label& operator=(Label&&) = default;
+
+        std::unique_ptr<QStaticText> text;///< created by the first label() call
+        int width = -1;///< text width the text was laid out for, -1 if it must be rebuilt
+    };
+
+    int mUpdateDepth = 0;///< nesting depth of beginUpdate()
+    bool mGeometryPending = false;///< a setter changed a value since the last updateGeometry()
+
+    QString mName;///< the identification of this monitor
+    Owner mOwner;///< the owning Screen and the id it assigned, if any
+    QRect mScaledBounds;///< scaled bounding rectangle as last seen by the owning Screen
+    QRect mUnscaledBounds;///< unscaled bounding rectangle as last seen by the owning Screen
+    GeometryUpdate mNotifiedGeometry;///< geometry as last seen by the owning Screen, to report deltas
+
+    mutable Label mLabel;///< cached info text layout, see label()
+
+    Border mBorders[4];///< border geometry and selection state, indexed by BorderIndex
+    ScaledRects mUnscaledRects;///< rectangles at scale 1, rebuilt by updateGeometry()
+    mutable ScaledRects mScaledRects;///< rectangles at the last scale other than 1, invalidated by updateGeometry()
+
+    Coordinate mWidth;///< screen geometry in pixels
+    Coordinate mHeight;///< screen geometry in pixels
+    Coordinate mXOffset;///< screen offset in pixels
+    Coordinate mYOffset;///< screen offset in pixels
+    Coordinate mVerticalLetterboxBarWidth;///< the height of the horizontal letterbox bars
+    Coordinate mHorizontalLetterboxBarHeight;///< the width of the vertical letterbox bars
+
+
+
+    static const Coordinate BORDER_WIDTH = 16;///< how wide each border should be
+};
+
+// std::vector copies monitors it cannot move without exceptions, and copies leave the Screen
+static_assert(std::is_nothrow_move_constructible<Monitor>::value, "monitors must keep their Screen when a std::vector relocates them");
+
+
+/*
+ *
+ *
+ *
+ *
+ * *************************************************************************************************************************************************
+ * SCREEN
+ * *************************************************************************************************************************************************
+ *
+ *
+ *
+ *
+ */
+class Screen {
+    // monitors point back to their Screen
+    Q_DISABLE_COPY(Screen)
+
+    std::vector<Monitor> mMonitors; ///< all known monitors, stored contiguously in the order they were added
+    double mScale = 1.0 / 10.0;
+
+    QHash<MonitorId, int> mSlots;///< index of each monitor id in mMonitors
+    QHash<QString, MonitorId> mIdsByName;///< id of each monitor name
+    SpatialGrid mHitGrid{hitGridCellSize(mScale)};///< scaled bounding rectangles of all monitors, for hit-testing
+    BorderHitTable mBorderHits;///< scaled border rectangles of all monitors, in slot order
+    MonitorId mNextMonitorId = INVALID_MONITOR_ID + 1;///< id assigned to the next added monitor
+
+    MonitorId mVolatileMonitor = INVALID_MONITOR_ID;///< monitor drawn on top of the static layer, e.g. while dragging
+    quint64 mStaticGeneration = 0;///< changes whenever the static layer (all monitors but the volatile one) changes
+    QRegion mDirtyRegion;///< scaled area changed since the last takeDirtyRegion()
+
+    /**
+     * @brief Add generated monitors, all or none, offset to start below the current layout
+     * @param xs, ys position of each spec relative to the top left corner of the generated block
+     */
+    QVector<MonitorId> addGenerated(const QVector<MonitorSpec>& specs, const std::vector<qint64>& xs, const std::vector<qint64>& ys) {
+        const QRect layout = layoutBounds();
+        const qint64 originX = layout.isNull() ? 0 : layout.left();
+        const qint64 originY = layout.isNull() ? 0 : qint64(layout.bottom()) + 1;
+
+        // validate everything before adding anything
+        QSet<QString> names;
+        names.reserve(specs.size());
+        for(int i = 0; i < specs.size(); i++) {
+            const MonitorSpec& spec = specs.at(i);
+            if(monitorExists(spec.name) || names.contains(spec.name))
+                return QVector<MonitorId>();
+            names.insert(spec.name);
+
+            const qint64 x = originX + xs[size_t(i)];
+            const qint64 y = originY + ys[size_t(i)];
+            if(!CoordinateMath::fits(x) || !CoordinateMath::fits(y)
+                    || !Monitor::isValidGeometry(GeometryUpdate().setWidth(spec.width).setHeight(spec.height)
+                                                 .setXOffset(Coordinate(x)).setYOffset(Coordinate(y))
+                                                 .setVerticalLetterboxBarWidth(spec.verticalLetterboxBarWidth)
+                                                 .setHorizontalLetterboxBarHeight(spec.horizontalLetterboxBarHeight)))
+                throw std::invalid_argument("generated monitor has an invalid geometry");
+        }
+
+        QVector<MonitorId> ids;
+        ids.reserve(specs.size());
+        reserve(int(mMonitors.size()) + specs.size());
+        for(int i = 0; i < specs.size(); i++) {
+            const MonitorSpec& spec = specs.at(i);
+            addMonitor(spec.name, spec.width, spec.height, Coordinate(originX + xs[size_t(i)]), Coordinate(originY + ys[size_t(i)]),
+                       spec.verticalLetterboxBarWidth, spec.horizontalLetterboxBarHeight);
+            ids.push_back(monitorId(spec.name));
+        }
+        return ids;
+    }
+
+    /// \brief A position tried by resolveOverlaps()
+    struct SnapPosition {
+        qint64 distance;///< squared distance to the desired position
+        QPoint position;///< top left corner
+
+        /// \brief Heap order: nearest first, ties broken by position so the search is deterministic
+        bool operator<(const SnapPosition& o) const {
+            if(distance != o.distance)
+                return distance > o.distance;
+            if(position.y() != o.position.y())
+                return position.y() > o.position.y();
+            return position.x() > o.position.x();
+        }
+    };
+
+    SnapStatistics mSnapStatistics;///< broad phase counters of snap()
+    QVector<MonitorId> mSnapCandidates;///< scratch buffer for the snap() broad phase
+    QVector<MonitorId> mSnapRequery;///< scratch buffer for the overlap tests of resolveOverlaps()
+    std::vector<SnapPosition> mSnapQueue;///< scratch heap of resolveOverlaps()
+    QSet<quint64> mSnapVisited;///< scratch buffer for resolveOverlaps(), positions already tested
+    QVector<MonitorId> mVisibleMonitors;///< scratch buffer for visibleMonitors()
+
+    std::multiset<int> mLefts, mTops, mRights, mBottoms;///< edges of the unscaled bounding rectangles of all monitors, for layoutBounds()
+
+    static const int LABEL_MIN_SIZE = 24;///< monitors smaller than this many widget pixels are drawn without label
+    static const int BORDER_MERGE_SIZE = 6;///< monitors this small draw their borders as one rectangle
+    static const int MAX_SNAP_STEPS = 256;///< positions resolveOverlaps() tests before using a fallback
+    static const int HIT_GRID_CELL_SIZE = 320;///< desktop pixels per hit grid cell, so a monitor covers the same cells at every zoom
+
+    /// \brief Edge length of a hit grid cell in widget pixels at scale
+    static int hitGridCellSize(double scale) {
+        return std::max(1, int(std::lround(HIT_GRID_CELL_SIZE * scale)));
+    }
+
+    bool monitorExists(const QString& name) {
+        return mIdsByName.contains(name);
+    }
+
+    Monitor* getMonitor(const QString& name){
+        return monitor(mIdsByName.value(name, INVALID_MONITOR_ID));
+    }
+
+    MonitorId mCurrentMonitorSelection = INVALID_MONITOR_ID;
+
+    QVector<BorderHandle> mSelectedBorders[4];///< selected borders per BorderIndex, in selection order
+    QVector<ScreenObserver*> mObservers;///< receivers of all changes
+    quint64 mBorderGeneration = 0;///< changes whenever the selected borders, their unscaled geometry or their colors change
+    quint64 mLayoutGeneration = 0;///< changes with mBorderGeneration, and whenever monitors are added, removed or change their unscaled geometry
+    mutable std::vector<Border> mSelectedBorderCache[4];///< copies of the selected borders, for selectedBorderView()
+    mutable quint64 mSelectedBorderCacheGeneration = ~quint64(0);///< mBorderGeneration the cache was built for
+
+    /// \brief Mark the scaled area of m as changed; changes to the volatile monitor keep the static layer
+    void invalidate(const Monitor& m) {
+        mDirtyRegion += m.mScaledBounds;
+        if(m.id() != mVolatileMonitor)
+            mStaticGeneration++;
+    }
+
+    /// \brief Change the selected monitor, marking both the old and new selection as changed, and notify the observers
+    void setSelection(MonitorId selection) {
+        if(selection == mCurrentMonitorSelection)
+            return;
+
+        if(const Monitor* previous = monitor(mCurrentMonitorSelection))
+            invalidate(*previous);
+        if(const Monitor* next = monitor(selection))
+            invalidate(*next);
+
+        mCurrentMonitorSelection = selection;
+        notify(ScreenChange::SelectionChanged, selection);
+    }
+
+    /// \brief Whether border is in the selection of its BorderIndex
+    bool isSelected(const BorderHandle& border) const {
+        return mSelectedBorders[int(border.border)].contains(border);
+    }
+
+    /// \brief Whether any border of monitor id is selected
+    bool hasSelectedBorder(MonitorId id) const {
+        for(int i = 0; i < 4; i++)
+            for(const BorderHandle& h : mSelectedBorders[i])
+                if(h.monitor == id)
+                    return true;
+        return false;
+    }
+
+    /// \brief Record a change of the selected borders, invalidating selectedBorderView() and published snapshots
+    void selectedBordersChanged() {
+        mBorderGeneration++;
+        mLayoutGeneration++;
+    }
+
+    /// \brief Rebuild the scaled rectangles of m in the hit grid and the border hit table, and mark both areas dirty
+    void updateScaledGeometry(Monitor& m) {
+        // the area covered before and after the change has to be redrawn
+        invalidate(m);
+        m.mScaledBounds = m.boundingRectangle(mScale);
+        invalidate(m);
+
+        mHitGrid.update(m.id(), m.mScaledBounds);
+
+        // borders only count where they overlap the bounding rectangle
+        const int slot = mSlots.value(m.id());
+        for(int i = 0; i < 4; i++)
+            mBorderHits.setRect(slot, BorderIndex(i), m.borderRect(BorderIndex(i), mScale) & m.mScaledBounds);
+    }
+
+    /// \brief Add the edges of a monitor area to the layout bounds
+    void indexEdges(const QRect& r) {
+        mLefts.insert(r.left());
+        mTops.insert(r.top());
+        mRights.insert(r.right());
+        mBottoms.insert(r.bottom());
+    }
+
+    /// \brief Remove the edges of a monitor area from the layout bounds
+    void unindexEdges(const QRect& r) {
+        mLefts.erase(mLefts.find(r.left()));
+        mTops.erase(mTops.find(r.top()));
+        mRights.erase(mRights.find(r.right()));
+        mBottoms.erase(mBottoms.find(r.bottom()));
+    }
+
+    /// \brief Deliver change to all observers
+    void notify(const ScreenChange& change) {
+        // observers may remove themselves while being notified
+        const QVector<ScreenObserver*> observers = mObservers;
+        for(ScreenObserver* o : observers)
+            o->screenChanged(change);
+    }
+
+    /// \brief Notify about a monitor or border change \overload
+    void notify(ScreenChange::Type type, MonitorId monitor, BorderIndex border = BorderIndex::BOTTOM) {
+        ScreenChange change;
+        change.type = type;
+        change.monitor = monitor;
+        change.border = border;
+        notify(change);
+    }
+
+    /// \brief Report how the geometry of m changed since the last report
+    void notifyGeometryDelta(Monitor& m) {
+        const GeometryUpdate previous = m.mNotifiedGeometry;
+        const GeometryUpdate current = m.geometryFields();
+        m.mNotifiedGeometry = current;
+
+        const auto delta = [&](GeometryUpdate::Field f) {
+            return int(qint64(current.value(f)) - qint64(previous.value(f)));
+        };
+
+        ScreenChange change;
+        change.monitor = m.id();
+
+        const QPoint offsetDelta(delta(GeometryUpdate::XOffset), delta(GeometryUpdate::YOffset));
+        if(!offsetDelta.isNull()) {
+            change.type = ScreenChange::MonitorMoved;
+            change.offsetDelta = offsetDelta;
+            notify(change);
+            change.offsetDelta = QPoint();
+        }
+
+        const QSize sizeDelta(delta(GeometryUpdate::Width), delta(GeometryUpdate::Height));
+        if(!sizeDelta.isNull()) {
+            change.type = ScreenChange::MonitorResized;
+            change.sizeDelta = sizeDelta;
+            notify(change);
+        }
+
+        const QSize letterboxDelta(delta(GeometryUpdate::VerticalLetterboxBarWidth), delta(GeometryUpdate::HorizontalLetterboxBarHeight));
+        if(!letterboxDelta.isNull()) {
+            change.type = ScreenChange::LetterboxChanged;
+            change.sizeDelta = letterboxDelta;
+            notify(change);
+        }
+    }
+
+    /// \brief Find the first monitor whose scaled bounding rectangle contains pos
+    MonitorId hitTest(const QPoint& pos) const {
+        for(MonitorId id : mHitGrid.candidates(pos))
+            if(monitor(id)->boundingRectangle(mScale).contains(pos))
+                return id;
+        return INVALID_MONITOR_ID;
+    }
+
+    /**
+     * @brief Broad phase of snap(): find the monitors that may be within the snap threshold of rect
+     * @param rect unscaled rectangle of the moved monitor
+     * @param out receives the candidate ids in ascending (= list) order
+     */
+    void snapCandidates(const QRect& rect, double widthTreshold, double heightTreshold, QVector<MonitorId>& out) const {
+        const QRect testRect = rect.adjusted(-widthTreshold / 2, -heightTreshold / 2, widthTreshold / 2, heightTreshold / 2);
+        // the grid holds scaled rectangles; pad for rounding and for minimum border sizes
+        const QRect scaledTestRect = QRect(testRect.topLeft() * mScale, testRect.bottomRight() * mScale).adjusted(-3, -3, 3, 3);
+        mHitGrid.candidates(scaledTestRect, out);
+    }
+
+    /// \brief Queue position for resolveOverlaps() unless it leaves the coordinate range
+    void queueSnapPosition(qint64 x, qint64 y, const QSize& size, const QPoint& desired) {
+        if(!CoordinateMath::fits(x) || !CoordinateMath::fits(x + size.width()) || !CoordinateMath::fits(y) || !CoordinateMath::fits(y + size.height()))
+            return;
+
+        const qint64 dx = x - desired.x();
+        const qint64 dy = y - desired.y();
+        mSnapQueue.push_back(SnapPosition{dx * dx + dy * dy, QPoint(int(x), int(y))});
+        std::push_heap(mSnapQueue.begin(), mSnapQueue.end());
+    }
+
+    /**
+     * @brief The position nearest to desired at which rect does not overlap any monitor but moving
+     *
+     * Best-first search starting at rect: a position overlapping monitors leads to the positions just left, right,
+     * above and below each of them. Positions beyond the layout bounds never overlap and are queued up front,
+     * so a free position is found even if the search is cut short after MAX_SNAP_STEPS positions.
+     */
+    QPoint resolveOverlaps(const Monitor& moving, const QRect& rect, const QPoint& desired) {
+        const QSize size = rect.size();
+        const QRect layout = layoutBounds();
+
+        mSnapQueue.clear();
+        mSnapVisited.clear();
+        queueSnapPosition(rect.left(), rect.top(), size, desired);
+
+        // the fallbacks, beyond each side of the layout
+        QPoint fallback = moving.boundingRectangle().topLeft();
+        qint64 fallbackDistance = std::numeric_limits<qint64>::max();
+        const qint64 fallbacks[4][2] = {
+            { qint64(layout.left()) - size.width(), rect.top() },
+            { qint64(layout.right()) + 1, rect.top() },
+            { rect.left(), qint64(layout.top()) - size.height() },
+            { rect.left(), qint64(layout.bottom()) + 1 }
+        };
+        for(const auto& f : fallbacks) {
+            const size_t queued = mSnapQueue.size();
+            queueSnapPosition(f[0], f[1], size, desired);
+            if(mSnapQueue.size() > queued) {
+                const qint64 dx = f[0] - desired.x(), dy = f[1] - desired.y();
+                if(dx * dx + dy * dy < fallbackDistance) {
+                    fallbackDistance = dx * dx + dy * dy;
+                    fallback = QPoint(int(f[0]), int(f[1]));
+                }
+            }
+        }
+
+        for(int step = 0; step < MAX_SNAP_STEPS && !mSnapQueue.empty(); step++) {
+            std::pop_heap(mSnapQueue.begin(), mSnapQueue.end());
+            const QPoint position = mSnapQueue.back().position;
+            mSnapQueue.pop_back();
+
+            const quint64 key = (quint64(quint32(position.x())) << 32) | quint32(position.y());
+            if(mSnapVisited.contains(key))
+                continue;
+            mSnapVisited.insert(key);
+
+            const QRect candidate(position, size);
+            bool overlaps = false;
+            snapCandidates(candidate, 0, 0, mSnapRequery);
+            for(MonitorId id : mSnapRequery) {
+                if(id == moving.id())
+                    continue;
+
+                mSnapStatistics.lastCandidateCount++;
+                const QRect other = monitor(id)->boundingRectangle();
+                if(!other.intersects(candidate))
+                    continue;
+
+                overlaps = true;
+                queueSnapPosition(qint64(other.left()) - size.width(), position.y(), size, desired);
+                queueSnapPosition(qint64(other.right()) + 1, position.y(), size, desired);
+                queueSnapPosition(position.x(), qint64(other.top()) - size.height(), size, desired);
+                queueSnapPosition(position.x(), qint64(other.bottom()) + 1, size, desired);
+            }
+
+            if(!overlaps)
+                return position;
+        }
+
+        return fallback;
+    }
+
+public:
+    Screen() {}
+
+    /// \brief Called by Monitor::updateGeometry to keep the hit-test index current
+    void monitorGeometryChanged(Monitor& m) {
+        updateScaledGeometry(m);
+
+        // the border view only shows selected borders
+        mLayoutGeneration++;
+        if(hasSelectedBorder(m.id()))
+            mBorderGeneration++;
+
+        unindexEdges(m.mUnscaledBounds);
+        m.mUnscaledBounds = m.boundingRectangle();
+        indexEdges(m.mUnscaledBounds);
+
+        notifyGeometryDelta(m);
+    }
+
+    /// \brief Deliver all future changes to observer, until it is removed
+    void addObserver(ScreenObserver* observer) {
+        if(!mObservers.contains(observer))
+            mObservers.push_back(observer);
+    }
+
+    void removeObserver(ScreenObserver* observer) {
+        mObservers.removeAll(observer);
+    }
+
+    /**
+     * @brief Draw the monitor with this id on top of a cached layer of all other monitors
+     *
+     * Changes to the volatile monitor do not change staticGeneration(), so the layer
+     * holding all other monitors can be reused while it is being dragged.
+     */
+    void setVolatileMonitor(MonitorId id) {
+        if(id == mVolatileMonitor)
+            return;
+
+        mVolatileMonitor = id;
+        mStaticGeneration++;
+    }
+
+    MonitorId volatileMonitor() const {
+        return mVolatileMonitor;
+    }
+
+    /// \brief Changes whenever the drawing of any monitor but the volatile one changes
+    quint64 staticGeneration() const {
+        return mStaticGeneration;
+    }
+
+    /// \brief Return and reset the scaled area that changed since the last call
+    QRegion takeDirtyRegion() {
+        QRegion dirty = mDirtyRegion;
+        mDirtyRegion = QRegion();
+        return dirty;
+    }
+
+    const Monitor* currentlySelectedMonitor() {
+        return monitor(mCurrentMonitorSelection);
+    }
+
+    /// \brief Retrieve a monitor by id, or nullptr; valid until the next addMonitor or deleteMonitor
+    const Monitor* monitor(MonitorId id) const {
+        auto slot = mSlots.find(id);
+        return slot == mSlots.end() ? nullptr : &mMonitors[slot.value()];
+    }
+
+    /// \brief Retrieve a monitor by id, or nullptr \overload
+    Monitor* monitor(MonitorId id) {
+        auto slot = mSlots.find(id);
+        return slot == mSlots.end() ? nullptr : &mMonitors[slot.value()];
+    }
+
+    /// \brief Retrieve a border by handle, or nullptr; valid until the next addMonitor or deleteMonitor
+    const Border* border(const BorderHandle& handle) const {
+        const Monitor* m = monitor(handle.monitor);
+        return m ? &(*m)[handle.border] : nullptr;
+    }
+
+    void drawText(QPainter& painter, const Monitor& m) {
+        const QRect rect = m.boundingRectangle(mScale);
+
+        // the label would be unreadable
+        if(rect.width() < LABEL_MIN_SIZE || rect.height() < LABEL_MIN_SIZE)
+            return;
+
+        const QStaticText& label = m.label(rect.width());
+        const QSizeF labelSize = label.size();
+
+        // keep the text inside the monitor, like QPainter::drawText(QRect, ...) does
+        const bool clip = labelSize.width() > rect.width() || labelSize.height() > rect.height();
+        if(clip) {
+            painter.save();
+            painter.setClipRect(rect, Qt::IntersectClip);
+        }
+
+        // center vertically, the label is centered horizontally within the text width
+        painter.drawStaticText(QPointF(rect.left(), rect.top() + (rect.height() - labelSize.height()) / 2), label);
+
+        if(clip)
+            painter.restore();
+    }
+
+    void drawBorders(QPainter& painter, const Monitor& monitor) {
+        // borders this small would overlap: draw them as one rectangle, in a selection color if there is one
+        const QRect bounds = monitor.boundingRectangle(mScale);
+        if(bounds.width() <= BORDER_MERGE_SIZE || bounds.height() <= BORDER_MERGE_SIZE) {
+            QColor color = Qt::GlobalColor::lightGray;
+            for(size_t i = 0; i < 4; i++)
+                if(monitor[i].drawColor != Qt::GlobalColor::lightGray)
+                    color = monitor[i].drawColor;
+            painter.fillRect(bounds, color);
+            return;
+        }
+
+        // draw all borders
+        for(size_t i = 0; i < 4; i++) {
+            // draw a scaled down version of the borders
+            painter.fillRect(monitor.borderRect(BorderIndex(i), mScale), monitor[i].drawColor);
+        }
+
+        // draw info text
+        drawText(painter, monitor);
+    }
+
+    /// \brief Draw the borders of all monitors within the scaled viewport, or of all monitors if it is null, except excluded
+    void drawBorders(QPainter& painter, MonitorId excluded = INVALID_MONITOR_ID, const QRect& viewport = QRect()) {
+        // draw all visible monitors
+        for(MonitorId id : visibleMonitors(viewport))
+            if(id != excluded)
+                drawBorders(painter, *monitor(id));
+    }
+
+    void drawBoundingRectangle(QPainter& painter, const Monitor& monitor) {
+        QColor fillColor;
+        if(monitor.id() == mCurrentMonitorSelection)
+            fillColor = Qt::GlobalColor::darkGray;
+        else
+            fillColor = Qt::GlobalColor::lightGray;
+
+        const QRect rect = monitor.boundingRectangle(mScale);
+
+        // draw a scaled down version of the bounding rectangle
+        painter.fillRect(rect, fillColor);
+
+        // draw info text
+        drawText(painter, monitor);
+    }
+
+    /// \brief Draw the bounding rectangles of all monitors within the scaled viewport, or of all monitors if it is null, except excluded
+    void drawBoundingRectangle(QPainter& painter, MonitorId excluded = INVALID_MONITOR_ID, const QRect& viewport = QRect()) {
+        // draw all visible monitors
+        for(MonitorId id : visibleMonitors(viewport))
+            if(id != excluded)
+                drawBoundingRectangle(painter, *monitor(id));
+    }
+
+    /**
+     * @brief Ids of the monitors overlapping the scaled viewport, in list order; all monitors if it is null
+     *
+     * The result is valid until the next call.
+     */
+    const QVector<MonitorId>& visibleMonitors(const QRect& viewport) {
+        if(viewport.isNull()) {
+            mVisibleMonitors.clear();
+            for(const Monitor& m : mMonitors)
+                mVisibleMonitors.push_back(m.id());
+        }
+        else {
+            mHitGrid.candidates(viewport, mVisibleMonitors);
+        }
+        return mVisibleMonitors;
+    }
+
+    /**
+     * @brief Unscaled bounding rectangle of all monitors, a null rectangle if there are none
+     *
+     * Unites the boundingRectangle() of the monitors, which excludes the letterbox bars, like hit-testing, snapping
+     * and drawing do. Fitting the view, the fallbacks of resolveOverlaps() and generated layouts therefore line
+     * up with the monitors as they are drawn.
+     */
+    QRect layoutBounds() const {
+        if(mLefts.empty())
+            return QRect();
+        return QRect(QPoint(*mLefts.begin(), *mTops.begin()), QPoint(*mRights.rbegin(), *mBottoms.rbegin()));
+    }
+
+    /// \brief Factor from desktop pixels to widget pixels
+    double scale() const {
+        return mScale;
+    }
+
+    /// \brief Change the factor from desktop pixels to widget pixels, e.g. to zoom; rebuilds all scaled rectangles, the generations stay
+    void setScale(double scale) {
+        assert(scale > 0);
+        if(scale == mScale)
+            return;
+
+        mScale = scale;
+        mHitGrid.setCellSize(hitGridCellSize(mScale));
+        for(Monitor& m : mMonitors)
+            updateScaledGeometry(m);
+        mStaticGeneration++;
+    }
+
+    /// \brief Delete the monitor called name; returns its id, or INVALID_MONITOR_ID if there is none
+    MonitorId deleteMonitor(const QString& name) {
+        const Monitor* deleted = getMonitor(name);
+        if(!deleted)
+            return INVALID_MONITOR_ID;
+
+        const MonitorId id = deleted->id();
+
+        // forget the selected borders of the deleted monitor
+        for(int i = 0; i < 4; i++)
+            for(int b = mSelectedBorders[i].size() - 1; b >= 0; b--)
+                if(mSelectedBorders[i].at(b).monitor == id) {
+                    mSelectedBorders[i].remove(b);
+                    selectedBordersChanged();
+                    notify(ScreenChange::BorderDeselected, id, BorderIndex(i));
+                }
+        mLayoutGeneration++;
+
+        setSelection(INVALID_MONITOR_ID);
+
+        const int slot = mSlots.take(id);
+        mIdsByName.remove(name);
+
+        invalidate(*deleted);
+        unindexEdges(deleted->mUnscaledBounds);
+        if(id == mVolatileMonitor)
+            setVolatileMonitor(INVALID_MONITOR_ID);
+        mHitGrid.remove(id);
+        mBorderHits.removeSlot(slot);
+
+        // close the gap, keeping the order monitors were added in
+        mMonitors.erase(mMonitors.begin() + slot);
+        for(int i = slot; i < int(mMonitors.size()); i++)
+            mSlots.insert(mMonitors[i].id(), i);
+
+        notify(ScreenChange::MonitorRemoved, id);
+        return id;
+    }
+
+    /// \brief Delete all monitors and border selections; observers receive ScreenChange::Cleared last
+    void clear() {
+        for(int i = 0; i < 4; i++)
+            setSelectedBorders(BorderIndex(i), QVector<BorderHandle>());
+        setSelection(INVALID_MONITOR_ID);
+
+        for(const Monitor& m : mMonitors)
+            invalidate(m);
+        const std::vector<Monitor> removed = std::move(mMonitors);
+
+        mMonitors.clear();
+        mSlots.clear();
+        mIdsByName.clear();
+        mHitGrid.clear();
+        mBorderHits = BorderHitTable();
+        mLefts.clear();
+        mTops.clear();
+        mRights.clear();
+        mBottoms.clear();
+        mLayoutGeneration++;
+
+        setVolatileMonitor(INVALID_MONITOR_ID);
+        mStaticGeneration++;
+
+        for(const Monitor& m : removed)
+            notify(ScreenChange::MonitorRemoved, m.id());
+        notify(ScreenChange::Cleared, INVALID_MONITOR_ID);
+    }
+
+    /// \brief Reserve storage for count monitors, e.g. before a bulk import
+    void reserve(int count) {
+        mMonitors.reserve(count);
+        mSlots.reserve(count);
+        mIdsByName.reserve(count);
+    }
+
+    /// \brief All monitors, in the order they were added; valid until the next addMonitor or deleteMonitor
+    const std::vector<Monitor>& monitors() const {
+        return mMonitors;
+    }
+
+    /**
+     * @brief Add a monitor; offsets may be negative
+     * @return false if the name is taken
+     * @throw std::invalid_argument if the geometry fails Monitor::isValidGeometry
+     */
+    bool addMonitor(const QString& name, int xRes, int yRes, int xOff = 0, int yOff = 0, int horLetterBox = 0, int verLetterBox = 0) {
+        // allow unique names only
+        if(monitorExists(name))
+            return false;
+
+        if(!Monitor::isValidGeometry(GeometryUpdate().setWidth(xRes).setHeight(yRes).setXOffset(xOff).setYOffset(yOff)
+                                     .setVerticalLetterboxBarWidth(horLetterBox).setHorizontalLetterboxBarHeight(verLetterBox)))
+            throw std::invalid_argument("invalid monitor geometry");
+
+        setSelection(INVALID_MONITOR_ID);
+
+        // add monitor
+        mMonitors.push_back(Monitor(name, xRes, yRes, xOff, yOff, horLetterBox, verLetterBox));
+
+        // register the monitor, and index its geometry
+        Monitor& added = mMonitors.back();
+        added.mOwner.id = mNextMonitorId++;
+        added.mOwner.screen = this;
+        mSlots.insert(added.id(), int(mMonitors.size()) - 1);
+        mIdsByName.insert(name, added.id());
+        mBorderHits.appendSlot();
+        added.mNotifiedGeometry = added.geometryFields();
+        added.mUnscaledBounds = added.boundingRectangle();
+        indexEdges(added.mUnscaledBounds);
+        monitorGeometryChanged(added);
+
+        notify(ScreenChange::MonitorAdded, added.id());
+
+        // return true
+        return true;
+    }
+
+    /**
+     * @brief Add a rows x columns wall of identical monitors below the current layout
+     *
+     * Bezels are compensated with the letterbox fields: every monitor is its panel plus the bezels around it,
+     * with letterbox bars as wide as the bezels. The borders then line the visible panel, and the desktop image
+     * continues behind the bezels like on the physical wall.
+     * @param prefix the monitors are called "<prefix> <row>,<column>", counting from 1
+     * @return the ids of the added monitors, row by row; empty if a name is taken, then nothing is added
+     * @throw std::invalid_argument if a count or size is not positive, or the wall leaves the coordinate range
+     */
+    QVector<MonitorId> generateGrid(const QString& prefix, int rows, int columns, Coordinate panelWidth, Coordinate panelHeight,
+                                    Coordinate bezelWidth = 0, Coordinate bezelHeight = 0) {
+        if(rows <= 0 || columns <= 0 || panelWidth <= 0 || panelHeight <= 0 || bezelWidth < 0 || bezelHeight < 0)
+            throw std::invalid_argument("invalid monitor grid");
+
+        const qint64 tileWidth = qint64(panelWidth) + 2 * qint64(bezelWidth);
+        const qint64 tileHeight = qint64(panelHeight) + 2 * qint64(bezelHeight);
+        if(!CoordinateMath::fits(tileWidth) || !CoordinateMath::fits(tileHeight))
+            throw std::invalid_argument("invalid monitor grid");
+
+        QVector<MonitorSpec> specs;
+        std::vector<qint64> xs, ys;
+        specs.reserve(rows * columns);
+        xs.reserve(size_t(rows) * size_t(columns));
+        ys.reserve(size_t(rows) * size_t(columns));
+        for(int row = 0; row < rows; row++) {
+            for(int column = 0; column < columns; column++) {
+                specs.push_back(MonitorSpec(QString("%1 %2,%3").arg(prefix).arg(row + 1).arg(column + 1),
+                                            Coordinate(tileWidth), Coordinate(tileHeight), bezelWidth, bezelHeight));
+                xs.push_back(column * tileWidth);
+                ys.push_back(row * tileHeight);
+            }
+        }
+
+        return addGenerated(specs, xs, ys);
+    }
+
+    /**
+     * @brief Add monitors of mixed resolutions below the current layout, packed into rows without overlaps
+     *
+     * Shelf packing, next fit by decreasing height: the monitors are sorted by height, then placed left to right
+     * on a shelf as high as its first monitor, and a new shelf is started below when the next one would exceed
+     * maxWidth. O(N log N) for the sort, O(N) for the placement.
+     * @param maxWidth shelf width in pixels; 0 for about the square root of the total area, giving a roughly square block
+     * @return the ids of the added monitors in the order of specs; empty if a name is taken or repeated, then nothing is added
+     * @throw std::invalid_argument if a spec fails Monitor::isValidGeometry, or the block leaves the coordinate range
+     */
+    QVector<MonitorId> packMonitors(const QVector<MonitorSpec>& specs, Coordinate maxWidth = 0) {
+        qint64 widest = 0;
+        double area = 0;
+        for(const MonitorSpec& spec : specs) {
+            widest = std::max(widest, qint64(spec.width));
+            area += double(spec.width) * spec.height;
+        }
+        const qint64 shelfWidth = std::max(widest, maxWidth > 0 ? qint64(maxWidth) : qint64(std::ceil(std::sqrt(area))));
+
+        // tallest first; equal heights keep the order of specs
+        std::vector<int> order(size_t(specs.size()));
+        for(int i = 0; i < specs.size(); i++)
+            order[size_t(i)] = i;
+        std::stable_sort(order.begin(), order.end(), [&specs](int a, int b) {
+            return specs.at(a).height > specs.at(b).height;
+        });
+
+        std::vector<qint64> xs(size_t(specs.size())), ys(size_t(specs.size()));
+        qint64 x = 0, shelfTop = 0, shelfHeight = 0;
+        for(int i : order) {
+            const MonitorSpec& spec = specs.at(i);
+            if(x > 0 && x + spec.width > shelfWidth) {
+                shelfTop += shelfHeight;
+                shelfHeight = 0;
+                x = 0;
+            }
+
+            // the first monitor of a shelf is the tallest one on it
+            if(x == 0)
+                shelfHeight = spec.height;
+
+            xs[size_t(i)] = x;
+            ys[size_t(i)] = shelfTop;
+            x += spec.width;
+        }
+
+        return addGenerated(specs, xs, ys);
+    }
+
+    void moveMonitors(MonitorId id, const QPoint& target, const QPoint& source, const QRect& bounding) {
+        if(Monitor* mon = monitor(id)){
+            setSelection(id);
+            snap(*mon, target, source, bounding);
+        }
+    }
+
+    /**
+     * @brief Snap monitor to points of interest instead of straight moving
+     *
+     * Each axis independently snaps to the nearest alignment within 5% of the visible area: desktop 0, the
+     * edges of the visible area, and the edges and centers of the monitors near the target position. If the result
+     * overlaps other monitors, it is pushed out to the nearest position that does not. The result does not depend
+     * on the order of the monitors.
+     * @param target scaled position of the top left corner
+     * @param masterBounding scaled visible area, including the pan; its edges are converted to desktop pixels
+     */
+    void snap(Monitor& snapping, const QPoint& target, const QPoint& /*source*/, const QRect& masterBounding) {
+        const QSize size = snapping.boundingRectangle().size();
+        const QRect desired(target / mScale, size);
+        const QRect visible(masterBounding.topLeft() / mScale, masterBounding.bottomRight() / mScale);
+
+        const double widthTreshold = .05 * visible.width();
+        const double heightTreshold = .05 * visible.height();
+
+        mSnapStatistics.snapCalls++;
+        mSnapStatistics.lastCandidateCount = 0;
+
+        // gather the alignments per axis: the desktop origin, the canvas edges ...
+        SnapAxis x(desired.left(), widthTreshold);
+        SnapAxis y(desired.top(), heightTreshold);
+        x.offer(0);
+        y.offer(0);
+        x.offer(visible.left());
+        x.offer(qint64(visible.right()) + 1 - size.width());
+        y.offer(visible.top());
+        y.offer(qint64(visible.bottom()) + 1 - size.height());
+
+        // ... and the monitors within the threshold; an edge only attracts if the monitors are near on the other axis
+        snapCandidates(desired, 2 * widthTreshold, 2 * heightTreshold, mSnapCandidates);
+        for(MonitorId id : mSnapCandidates) {
+            if(id == snapping.id())
+                continue;
+
+            mSnapStatistics.lastCandidateCount++;
+            const QRect other = monitor(id)->boundingRectangle();
+            const qint64 horizontalGap = std::max(qint64(other.left()) - desired.right(), qint64(desired.left()) - other.right()) - 1;
+            const qint64 verticalGap = std::max(qint64(other.top()) - desired.bottom(), qint64(desired.top()) - other.bottom()) - 1;
+
+            if(verticalGap <= heightTreshold)
+                x.offerInterval(other.left(), qint64(other.right()) + 1, size.width());
+            if(horizontalGap <= widthTreshold)
+                y.offerInterval(other.top(), qint64(other.bottom()) + 1, size.height());
+        }
+
+        const QPoint snapped = resolveOverlaps(snapping, QRect(QPoint(x.result(), y.result()), size), desired.topLeft());
+
+        mSnapStatistics.candidatesTested += mSnapStatistics.lastCandidateCount;
+
+        snapping.setPosition(snapped);
+    }
+
+    /// \brief Broad phase counters of snap(), to check the per-event cost of dragging
+    const SnapStatistics& snapStatistics() const {
+        return mSnapStatistics;
+    }
+
+    void resetSnapStatistics() {
+        mSnapStatistics = SnapStatistics();
+    }
+
+    /**
+     * @brief Toggle the selection state of a single monitor; returns true if the monitor is now selected
+     */
+    bool toggleSingleMonitorSelection(const QString& selection) {
+        const MonitorId id = monitorId(selection);
+
+        // if "selection" is already selected, clear the selection
+        if(id != INVALID_MONITOR_ID && id == mCurrentMonitorSelection){
+            setSelection(INVALID_MONITOR_ID);
+            return false;
+        }
+        else{
+            setSelection(id);
+            return true;
+        }
+    }
+
+    void deselectCurrent(){
+        setSelection(INVALID_MONITOR_ID);
+    }
+
+    /// \brief Find the id of the monitor called name, or INVALID_MONITOR_ID
+    MonitorId monitorId(const QString& name) const {
+        return mIdsByName.value(name, INVALID_MONITOR_ID);
+    }
+
+    /// \brief Find the id of a clicked monitor, or INVALID_MONITOR_ID
+    MonitorId monitorAt(const QPoint& pos) const {
+        return hitTest(pos);
+    }
+
+    Monitor* getMonitor(const QPoint &pos) {
+        // find a clicked monitor
+        return monitor(hitTest(pos));
+    }
+
+    const QString getMonitorName(const QPoint& pos) const {
+        // find a clicked monitor
+        const Monitor* m = monitor(hitTest(pos));
+        return m ? m->getName() : "";
+    }
+
+    /**
+     * @brief Select a border: mainly specify the draw color
+     * @param monitor which monitor does the border belong to
+     * @param border border index
+     * @param color new draw color
+     */
+    void selectBorder(const QString& monitor, const int border, QColor color) {
+        // select only the monitor named like the selection
+        if(Monitor* m = getMonitor(monitor))
+            selectBorder(BorderHandle(m->id(), BorderIndex(border)), color);
+    }
+
+    /// \brief Select a border by handle \overload
+    void selectBorder(const BorderHandle& handle, QColor color) {
+        Monitor* m = monitor(handle.monitor);
+        if(!m || (*m)[handle.border].drawColor == color)
+            return;
+
+        (*m)[handle.border].drawColor = color;
+        invalidate(*m);
+        if(isSelected(handle))
+            selectedBordersChanged();
+    }
+
+    /**
+     * @brief Toggle a border in the selection of its BorderIndex
+     *
+     * A border not drawn in selectionColor is selected and drawn in selectionColor, otherwise it is
+     * deselected and drawn in light gray again.
+     * @return true if the border is selected now
+     */
+    bool toggleBorderSelection(const BorderHandle& handle, QColor selectionColor) {
+        const Border* b = border(handle);
+        if(!b)
+            return false;
+
+        QVector<BorderHandle>& selection = mSelectedBorders[int(handle.border)];
+
+        if(b->drawColor != selectionColor) {
+            selectBorder(handle, selectionColor);
+            selection.push_back(handle);
+            selectedBordersChanged();
+            notify(ScreenChange::BorderSelected, handle.monitor, handle.border);
+            return true;
+        }
+        // unselect if the border was already selected
+        else {
+            selectBorder(handle, Qt::GlobalColor::lightGray);
+            if(selection.removeAll(handle)) {
+                selectedBordersChanged();
+                notify(ScreenChange::BorderDeselected, handle.monitor, handle.border);
+            }
+            return false;
+        }
+    }
+
+    /// \brief The selected borders of index i, in selection order
+    const QVector<BorderHandle>& selectedBorders(BorderIndex i) const {
+        return mSelectedBorders[int(i)];
+    }
+
+    /// \brief Replace the selected borders of index i, e.g. when loading a layout; colors are not changed
+    void setSelectedBorders(BorderIndex i, const QVector<BorderHandle>& selection) {
+        const QVector<BorderHandle> previous = mSelectedBorders[int(i)];
+        if(previous == selection)
+            return;
+
+        mSelectedBorders[int(i)] = selection;
+        selectedBordersChanged();
+
+        for(const BorderHandle& h : previous)
+            if(!selection.contains(h))
+                notify(ScreenChange::BorderDeselected, h.monitor, h.border);
+        for(const BorderHandle& h : selection)
+            if(!previous.contains(h))
+                notify(ScreenChange::BorderSelected, h.monitor, h.border);
+    }
+
+    /**
+     * @brief The selected borders of index i, in selection order, without copying them
+     *
+     * The view is valid until borderGeneration() changes; poll it to find out whether the view has to
+     * be read again. Once the cache has grown, rebuilding it does not allocate.
+     *
+     * GUI thread only: the first call after a change rebuilds the cache shared by all views. Worker threads
+     * read the selected borders from the snapshots of a SnapshotPublisher instead, see screensnapshot.h.
+     */
+    BorderView selectedBorderView(BorderIndex i) const {
+        if(mSelectedBorderCacheGeneration != mBorderGeneration) {
+            for(int s = 0; s < 4; s++) {
+                mSelectedBorderCache[s].clear();
+                for(const BorderHandle& h : mSelectedBorders[s])
+                    mSelectedBorderCache[s].push_back(*border(h));
+            }
+            mSelectedBorderCacheGeneration = mBorderGeneration;
+        }
+
+        const std::vector<Border>& cache = mSelectedBorderCache[int(i)];
+        return BorderView(cache.data(), int(cache.size()));
+    }
+
+    /// \brief Changes whenever the selected borders, their unscaled geometry or their colors change; zooming does not change it
+    quint64 borderGeneration() const {
+        return mBorderGeneration;
+    }
+
+    /// \brief Changes with borderGeneration(), and whenever monitors are added, removed or change their unscaled geometry
+    quint64 layoutGeneration() const {
+        return mLayoutGeneration;
+    }
+
+    /**
+     * @brief Find if a border
+     * @param pos click position
+     * @param \out monitor name of the monitor the clicked border belongs to, or ""
+     * @param border index of the border, or -1 \out
+     */
+    const Border* getBorder(const QPoint& pos, QString& monitor, int& border) const {
+        const BorderHandle handle = borderAt(pos);
+        const Monitor* m = this->monitor(handle.monitor);
+
+        monitor = m ? m->getName() : "";
+        border = m ? int(handle.border) : -1;
+        return m ? &(*m)[handle.border] : nullptr;
+    }
+
+    /// \brief Find the border at pos; the returned handle is invalid if there is none
+    BorderHandle borderAt(const QPoint& pos) const {
+        // only monitors sharing a grid cell with the click can contain it
+        for(MonitorId id : mHitGrid.candidates(pos)) {
+            // test all four borders at once
+            const int border = mBorderHits.findInSlot(mSlots.value(id), pos);
+            if(border >= 0)
+                return BorderHandle(id, BorderIndex(border));
+        }
+        return BorderHandle();
+    }
+
+    /**
+     * @brief Find the borders at a batch of points by scanning the packed border table
+     * @param out receives one handle per point, invalid where no border was hit
+     */
+    void bordersAt(const QPoint* points, int count, BorderHandle* out) const {
+        for(int i = 0; i < count; i++) {
+            const int entry = mBorderHits.find(points[i]);
+            out[i] = entry < 0 ? BorderHandle() : BorderHandle(mMonitors[entry / 4].id(), BorderIndex(entry % 4));
+        }
+    }
+};
+
+inline void Monitor::notifyGeometryChanged() {
+    if(mOwner.screen)
+        mOwner.screen->monitorGeometryChanged(*this);
+}
+
+
+
+
+
+
+/*
+ *
+ *
+ *
+ *
+ * *************************************************************************************************************************************************
+ * HISTORY
+ * *************************************************************************************************************************************************
+ *
+ *
+ *
+ *
+ */
+/**
+ * @brief Undo commands operating on a Screen
+ *
+ * Commands store only what an operation changed, and address monitors by name: monitor ids are
+ * not reused, so a monitor restored by undoing its deletion gets a new id, but keeps its name.
+ * All commands are pushed after the operation was applied, so their first redo() does nothing.
+ */
+namespace History {
+
+/// \brief Command ids for QUndoCommand::id()
+enum CommandId {
+    GeometryCommandId = 1
+};
+
+/// \brief The selection state of one border
+struct BorderState {
+    QColor color = Qt::GlobalColor::lightGray;///< draw color of the border
+    int position = -1;///< index in the selected borders of its BorderIndex, -1 if not selected
+
+    /// \brief Read the state of a border
+    static BorderState capture(const Screen& screen, const BorderHandle& handle) {
+        BorderState state;
+        if(const Border* b = screen.border(handle)) {
+            state.color = b->drawColor;
+            state.position = screen.selectedBorders(handle.border).indexOf(handle);
+        }
+        return state;
+    }
+
+    /// \brief Give a border this state
+    void restore(Screen& screen, const BorderHandle& handle) const {
+        screen.selectBorder(handle, color);
+
+        QVector<BorderHandle> selection = screen.selectedBorders(handle.border);
+        selection.removeAll(handle);
+        if(position >= 0)
+            selection.insert(std::min(position, selection.size()), handle);
+        screen.setSelectedBorders(handle.border, selection);
+    }
+};
+
+/**
+ * @brief Changed geometry fields of one monitor
+ *
+ * Commands with the same nonzero merge key for the same monitor are merged into one history entry.
+ */
+class GeometryCommand : public QUndoCommand {
+public:
+    GeometryCommand(Screen* screen, const QString& monitor, const GeometryUpdate& before, const GeometryUpdate& after, int mergeKey = 0) :
+        mScreen(screen), mMonitor(monitor), mMergeKey(mergeKey) {
+        // keep only the fields that changed
+        const GeometryUpdate::Field fields[] = {GeometryUpdate::Width, GeometryUpdate::Height, GeometryUpdate::XOffset, GeometryUpdate::YOffset,
+                                                GeometryUpdate::VerticalLetterboxBarWidth, GeometryUpdate::HorizontalLetterboxBarHeight};
+        for(GeometryUpdate::Field f : fields) {
+            if(after.contains(f) && (!before.contains(f) || before.value(f) != after.value(f))) {
+                mBefore.set(f, before.value(f));
+                mAfter.set(f, after.value(f));
+            }
+        }
+    }
+
+    /// \brief True if the command changes nothing and need not be pushed
+    bool isEmpty() const {
+        return mAfter.fields == 0;
+    }
+
+    void undo() Q_DECL_OVERRIDE {
+        apply(mBefore);
+    }
+
+    void redo() Q_DECL_OVERRIDE {
+        if(mApplied)
+            mApplied = false;
+        else
+            apply(mAfter);
+    }
+
+    int id() const Q_DECL_OVERRIDE {
+        return GeometryCommandId;
+    }
+
+    bool mergeWith(const QUndoCommand* other) Q_DECL_OVERRIDE {
+        const GeometryCommand* next = static_cast<const GeometryCommand*>(other);
+        if(mMergeKey == 0 || next->mMergeKey != mMergeKey || next->mMonitor != mMonitor)
+            return false;
+
+        // keep the oldest before and the newest after value of every field
+        const GeometryUpdate::Field fields[] = {GeometryUpdate::Width, GeometryUpdate::Height, GeometryUpdate::XOffset, GeometryUpdate::YOffset,
+                                                GeometryUpdate::VerticalLetterboxBarWidth, GeometryUpdate::HorizontalLetterboxBarHeight};
+        for(GeometryUpdate::Field f : fields) {
+            if(!next->mAfter.contains(f))
+                continue;
+            if(!mBefore.contains(f))
+                mBefore.set(f, next->mBefore.value(f));
+            mAfter.set(f, next->mAfter.value(f));
+        }
+        return true;
+    }
+
+private:
+    void apply(const GeometryUpdate& update) {
+        if(Monitor* m = mScreen->monitor(mScreen->monitorId(mMonitor)))
+            m->apply(update);
+    }
+
+    Screen* mScreen;
+    QString mMonitor;///< name of the changed monitor
+    GeometryUpdate mBefore;///< changed fields before the change
+    GeometryUpdate mAfter;///< changed fields after the change
+    int mMergeKey;///< commands with the same nonzero key are merged
+    bool mApplied = true;///< the change was applied before the command was pushed
+};
+
+/**
+ * @brief The selection of one border was changed
+ */
+class BorderCommand : public QUndoCommand {
+public:
+    BorderCommand(Screen* screen, const QString& monitor, BorderIndex border, const BorderState& before, const BorderState& after) :
+        mScreen(screen), mMonitor(monitor), mBorder(border), mBefore(before), mAfter(after) {
+    }
+
+    void undo() Q_DECL_OVERRIDE {
+        apply(mBefore);
+    }
+
+    void redo() Q_DECL_OVERRIDE {
+        if(mApplied)
+            mApplied = false;
+        else
+            apply(mAfter);
+    }
+
+private:
+    void apply(const BorderState& state) {
+        const MonitorId id = mScreen->monitorId(mMonitor);
+        if(id != INVALID_MONITOR_ID)
+            state.restore(*mScreen, BorderHandle(id, mBorder));
+    }
+
+    Screen* mScreen;
+    QString mMonitor;///< name of the monitor the border belongs to
+    BorderIndex mBorder;///< the changed border
+    BorderState mBefore;///< selection before the change
+    BorderState mAfter;///< selection after the change
+    bool mApplied = true;///< the change was applied before the command was pushed
+};
+
+/**
+ * @brief A monitor was added or deleted
+ */
+class MonitorCommand : public QUndoCommand {
+public:
     /**
-     * @brief Toggle the selection state of a single monitor; returns true if the monitor is now selected
+     * @brief Record the monitor id, which was just added, or is about to be deleted
+     * @param added true if the monitor was added, false if it will be deleted
      */
-    bool toggleSingleMonitorSelection(const QString& selection) {
-        // if "selection" is already selected, clear the selection
-        if(mCurrentMonitorSelection && mCurrentMonitorSelection->getName() == selection){
-            mCurrentMonitorSelection = nullptr;
-            return false;
-        }
-        else{
-            mCurrentMonitorSelection = getMonitor(selection);
-            return true;
-        }
+    MonitorCommand(Screen* screen, MonitorId id, bool added) : mScreen(screen), mAdded(added) {
+        const Monitor* m = screen->monitor(id);
+        assert(m);
+
+        mMonitor = m->getName();
+        mGeometry = m->geometryFields();
+        for(int i = 0; i < 4; i++)
+            mBorders[i] = BorderState::capture(*screen, BorderHandle(id, BorderIndex(i)));
     }
 
-    void deselectCurrent(){
-        mCurrentMonitorSelection = nullptr;
+    void undo() Q_DECL_OVERRIDE {
+        if(mAdded)
+            remove();
+        else
+            restore();
     }
 
-    Monitor* getMonitor(const QPoint &pos) {
-        // find a clicked monitor
-        for(Monitor& m : mMonitorList)
-            if(m.boundingRectangle(mScale).contains(pos))
-                return &m;
-        return nullptr;
+    void redo() Q_DECL_OVERRIDE {
+        if(mApplied)
+            mApplied = false;
+        else if(mAdded)
+            restore();
+        else
+            remove();
     }
 
-    const QString getMonitorName(const QPoint& pos) const {
-        // find a clicked monitor
-        for(const Monitor& m : mMonitorList)
-            if(m.boundingRectangle(mScale).contains(pos))
-                return m.getName();
-        return "";
+private:
+    void remove() {
+        mScreen->deleteMonitor(mMonitor);
     }
 
-    /**
-     * @brief Select a border: mainly specify the draw color
-     * @param monitor which monitor does the border belong to
-     * @param border border index
-     * @param color new draw color
-     */
-    void selectBorder(const QString& monitor, const int border, QColor color) {
-        // select only the monitor named like the selection
-        for(Monitor& m : mMonitorList) {
-            if(m.getName() == monitor) {
-                m.operator [](border).drawColor = color;
-            }
-        }
-    }
+    void restore() {
+        mScreen->addMonitor(mMonitor, mGeometry.width, mGeometry.height, mGeometry.xOffset, mGeometry.yOffset,
+                            mGeometry.verticalLetterboxBarWidth, mGeometry.horizontalLetterboxBarHeight);
 
-    /**
-     * @brief Find if a border
-     * @param pos click position
-     * @param \out monitor name of the monitor the clicked border belongs to, or ""
-     * @param border index of the border, or -1 \out
-     */
-    const Border* getBorder(const QPoint& pos, QString& monitor, int& border) const {
-        monitor = "";
-        border = -1;
-        // select only the correctly named monitor
-        for(const Monitor& m : mMonitorList) {
-            // does the monitor contain the click (filter condition)
-            if(m.boundingRectangle(mScale).contains(pos)) {
-                // for each border
-                for(int i = 0; i < 4; i++) {
-                    // if border clicked
-                    if(m[i].qRect(mScale).contains(pos)) {
-                        monitor = m.getName();
-                        border = i;
-                        return &m[i];
-                    }
-                }
-            }
-        }
-        return nullptr;
+        const MonitorId id = mScreen->monitorId(mMonitor);
+        for(int i = 0; i < 4; i++)
+            mBorders[i].restore(*mScreen, BorderHandle(id, BorderIndex(i)));
     }
+
+    Screen* mScreen;
+    QString mMonitor;///< name of the monitor
+    GeometryUpdate mGeometry;///< all geometry fields of the monitor
+    BorderState mBorders[4];///< selection of the borders of the monitor
+    bool mAdded;///< true if the command adds the monitor, false if it deletes it
+    bool mApplied = true;///< the change was applied before the command was pushed
 };
 
+}
+
 
 
 
@@ -543,28 +2349,170 @@ public:
  *
  *
  */
-class ScreenDisplayWidget : public QWidget {
+class ScreenDisplayWidget : public QWidget, public ScreenObserver {
     Q_OBJECT
 public:
     explicit ScreenDisplayWidget(QWidget *parent = 0) : QWidget(parent) {
         mScreen = new Screen();
+        mScreen->addObserver(this);
+
+        // every undo or redo changes the screen
+        mHistory = new QUndoStack(this);
+        mHistory->setUndoLimit(DEFAULT_UNDO_LIMIT);
+        connect(mHistory, SIGNAL(indexChanged(int)), this, SLOT(updateDirtyRegion()));
+
+        // coalesces drag events arriving within one frame
+        mDragFrameTimer = new QTimer(this);
+        mDragFrameTimer->setSingleShot(true);
+        mDragFrameTimer->setInterval(DRAG_FRAME_INTERVAL);
+        mDragFrameTimer->setTimerType(Qt::PreciseTimer);
+        connect(mDragFrameTimer, SIGNAL(timeout()), this, SLOT(commitDragFrame()));
     }
 
     const Monitor* currentlySelectedMonitor() {
         return mScreen->currentlySelectedMonitor();
     }
 
+    /// \brief Retrieve a monitor by id, or nullptr; valid until the next addMonitor or deleteMonitor
+    Monitor* monitor(MonitorId id) {
+        return mScreen->monitor(id);
+    }
+
     void deleteMonitor(const QString& name) {
+        const MonitorId id = mScreen->monitorId(name);
+        if(id == INVALID_MONITOR_ID)
+            return;
+
+        History::MonitorCommand* command = new History::MonitorCommand(mScreen, id, false);
         mScreen->deleteMonitor(name);
-        repaint();
+        mHistory->push(command);
+        updateDirtyRegion();
+    }
+
+    /// \brief The monitors and border selection shown, e.g. to save or load a layout
+    Screen& screen() {
+        return *mScreen;
+    }
+
+    /// \brief Part of the scaled screen shown in the widget
+    QRect sceneRect() const {
+        return QRect(mPan, size());
+    }
+
+    /**
+     * @brief Keep the whole layout fitted into the widget
+     *
+     * The fit is updated when the widget is resized and when monitors are added or deleted, but not
+     * while dragging. Zooming or panning by hand turns auto-fit off.
+     */
+    void setAutoFit(bool autoFit) {
+        mAutoFit = autoFit;
+        if(mAutoFit)
+            fitToLayout();
+    }
+
+    bool autoFit() const {
+        return mAutoFit;
+    }
+
+    /// \brief Choose scale and pan so that all monitors are visible and as large as possible
+    void fitToLayout() {
+        const QRect bounds = mScreen->layoutBounds();
+        const QRect available = rect().adjusted(FIT_MARGIN, FIT_MARGIN, -FIT_MARGIN, -FIT_MARGIN);
+        if(bounds.isEmpty() || available.isEmpty())
+            return;
+
+        const double scale = qBound(double(MIN_SCALE),
+                                    std::min(double(available.width()) / bounds.width(), double(available.height()) / bounds.height()),
+                                    double(MAX_SCALE));
+
+        // center the layout
+        mScreen->setScale(scale);
+        mPan = (QPointF(bounds.center()) * scale).toPoint() - rect().center();
+        update();
+    }
+
+    /**
+     * @brief Zoom by factor, keeping the screen point under anchor in place
+     * @param anchor widget position, e.g. of the mouse
+     */
+    void zoom(double factor, const QPoint& anchor) {
+        mAutoFit = false;
+
+        const double oldScale = mScreen->scale();
+        const double newScale = qBound(double(MIN_SCALE), oldScale * factor, double(MAX_SCALE));
+
+        // the desktop position under the anchor stays under the anchor
+        const QPointF desktop = QPointF(anchor + mPan) / oldScale;
+        mPan = (desktop * newScale).toPoint() - anchor;
+
+        mScreen->setScale(newScale);
+        update();
+    }
+
+    /// \brief Scroll the shown part of the screen by delta widget pixels
+    void pan(const QPoint& delta) {
+        mAutoFit = false;
+        mPan += delta;
+        update();
+    }
+
+    /// \brief Undo history of all edits made through this widget
+    QUndoStack* history() {
+        return mHistory;
+    }
+
+    /**
+     * @brief Add a geometry change of monitor id, which was already applied, to the history
+     * @param mergeKey consecutive changes of the same monitor with the same nonzero key become one entry
+     */
+    void recordGeometryChange(MonitorId id, const GeometryUpdate& before, const GeometryUpdate& after, int mergeKey = 0) {
+        const Monitor* m = mScreen->monitor(id);
+        if(!m)
+            return;
+
+        History::GeometryCommand* command = new History::GeometryCommand(mScreen, m->getName(), before, after, mergeKey);
+        if(command->isEmpty())
+            delete command;
+        else
+            mHistory->push(command);
     }
 
     bool addMonitor(const QString& name, int xRes, int yRes, int xOff = 0, int yOff = 0, int horLetterBox = 0, int verLetterBox = 0) {
         bool added = mScreen->addMonitor(name, xRes, yRes, xOff, yOff, horLetterBox, verLetterBox);
-        repaint();
+        if(added)
+            mHistory->push(new History::MonitorCommand(mScreen, mScreen->monitorId(name), true));
+        updateDirtyRegion();
         return added;
     }
 
+    /// \brief Screen::generateGrid, undone as a single step
+    QVector<MonitorId> generateGrid(const QString& prefix, int rows, int columns, Coordinate panelWidth, Coordinate panelHeight,
+                                    Coordinate bezelWidth = 0, Coordinate bezelHeight = 0) {
+        const QVector<MonitorId> ids = mScreen->generateGrid(prefix, rows, columns, panelWidth, panelHeight, bezelWidth, bezelHeight);
+        recordGeneratedMonitors(ids, "Generate monitor grid");
+        return ids;
+    }
+
+    /// \brief Record monitors added by a generator as one history entry
+    void recordGeneratedMonitors(const QVector<MonitorId>& ids, const QString& text) {
+        if(ids.isEmpty())
+            return;
+
+        mHistory->beginMacro(text);
+        for(MonitorId id : ids)
+            mHistory->push(new History::MonitorCommand(mScreen, id, true));
+        mHistory->endMacro();
+        updateDirtyRegion();
+    }
+
+    /// \brief Screen::packMonitors, undone as a single step
+    QVector<MonitorId> packMonitors(const QVector<MonitorSpec>& specs, Coordinate maxWidth = 0) {
+        const QVector<MonitorId> ids = mScreen->packMonitors(specs, maxWidth);
+        recordGeneratedMonitors(ids, "Pack monitors");
+        return ids;
+    }
+
     void setInteractionMode(InteractionMode dm) {
         mInteractionMode = dm;
         repaint();
@@ -575,109 +2523,306 @@ public:
 
         // copy all borders into the result vector vector
         for(int i = 0; i < 4; i++) {
-            QVector<Border> bVec = result.at(i);
-            for(const Border* b : mBorders[i])
-                bVec.push_back(*b);
+            const BorderView borders = mScreen->selectedBorderView(BorderIndex(i));
+            QVector<Border>& bVec = result[i];
+            bVec.reserve(borders.size());
+            for(const Border& b : borders)
+                bVec.push_back(b);
         }
 
         return result;
     }
 
+    /// \brief The selected borders of index i without copying them; valid until the configuration changes
+    BorderView resultingBorders(BorderIndex i) const {
+        return mScreen->selectedBorderView(i);
+    }
+
+    /// \brief Changes whenever the result of resultingBorders() changes
+    quint64 resultingBorderGeneration() const {
+        return mScreen->borderGeneration();
+    }
+
     // drawing function
 protected:
-    void paintEvent(QPaintEvent *) Q_DECL_OVERRIDE {
+    void paintEvent(QPaintEvent *e) Q_DECL_OVERRIDE {
+        // redraw the cached monitors only if any of them changed
+        if(mStaticLayer.size() != staticLayerSize()
+                || mStaticLayerGeneration != mScreen->staticGeneration()
+                || mStaticLayerMode != mInteractionMode
+                || mStaticLayerPan != mPan)
+            renderStaticLayer();
+
         // create painter
         QPainter painter(this);
+        painter.setClipRegion(e->region());
+
+        // recomposite the changed area from the cache
+        painter.drawPixmap(0, 0, mStaticLayer);
+
+        // draw the volatile monitor on top
+        const Monitor* volatileMonitor = mScreen->monitor(mScreen->volatileMonitor());
+        if(volatileMonitor) {
+            painter.translate(-mPan);
+            drawMonitor(painter, *volatileMonitor);
+        }
+    }
+
+    // retained rendering
+private:
+    QSize staticLayerSize() const {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+        return size() * devicePixelRatioF();
+#else
+        return size() * devicePixelRatio();
+#endif
+    }
+
+    /// \brief Draw all monitors but the volatile one into mStaticLayer
+    void renderStaticLayer() {
+        mStaticLayer = QPixmap(staticLayerSize());
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+        mStaticLayer.setDevicePixelRatio(devicePixelRatioF());
+#else
+        mStaticLayer.setDevicePixelRatio(devicePixelRatio());
+#endif
 
         // reset drawing area
-        painter.fillRect(this->rect(), Qt::GlobalColor::white);
+        mStaticLayer.fill(Qt::GlobalColor::white);
+
+        // only monitors within the visible part of the screen are drawn
+        QPainter painter(&mStaticLayer);
+        painter.translate(-mPan);
+        const QRect viewport = sceneRect();
+
+        switch(mInteractionMode) {
+        case InteractionMode::ConfigureMonitors:
+            mScreen->drawBoundingRectangle(painter, mScreen->volatileMonitor(), viewport);
+            break;
+        case InteractionMode::SelectBottomBorder:
+        case InteractionMode::SelectRightBorder:
+        case InteractionMode::SelectTopBorder:
+        case InteractionMode::SelectLeftBorder:
+            mScreen->drawBorders(painter, mScreen->volatileMonitor(), viewport);
+            break;
+        default:
+            throw std::invalid_argument("unknown InteractionMode");
+        }
+
+        mStaticLayerGeneration = mScreen->staticGeneration();
+        mStaticLayerMode = mInteractionMode;
+        mStaticLayerPan = mPan;
+    }
 
+    void drawMonitor(QPainter& painter, const Monitor& monitor) {
         switch(mInteractionMode) {
         case InteractionMode::ConfigureMonitors:
-            mScreen->drawBoundingRectangle(painter);
+            mScreen->drawBoundingRectangle(painter, monitor);
             break;
         case InteractionMode::SelectBottomBorder:
         case InteractionMode::SelectRightBorder:
         case InteractionMode::SelectTopBorder:
         case InteractionMode::SelectLeftBorder:
-            mScreen->drawBorders(painter);
+            mScreen->drawBorders(painter, monitor);
             break;
         default:
             throw std::invalid_argument("unknown InteractionMode");
         }
     }
 
+public slots:
+    /// \brief Schedule a repaint of the area changed in mScreen
+    void updateDirtyRegion() {
+        update(mScreen->takeDirtyRegion().translated(-mPan));
+    }
+
+public:
+    /// \brief Forward the changes of the shown screen as onScreenChanged(), and selection changes as onMonitorSelected() or onMonitorDeSelected()
+    void screenChanged(const ScreenChange& change) Q_DECL_OVERRIDE {
+        // history commands find their monitors by name, which a cleared or loaded screen may give to other monitors
+        if(change.type == ScreenChange::Cleared)
+            mHistory->clear();
+
+        // refit once after a batch of added or removed monitors, e.g. when a layout is loaded
+        if(mAutoFit && !mFitPending && (change.type == ScreenChange::MonitorAdded || change.type == ScreenChange::MonitorRemoved)) {
+            mFitPending = true;
+            QTimer::singleShot(0, this, SLOT(applyPendingFit()));
+        }
+
+        // clicks, drags, undo and redo all change the selection through the screen
+        if(change.type == ScreenChange::SelectionChanged) {
+            if(change.monitor != INVALID_MONITOR_ID)
+                emit onMonitorSelected(change.monitor);
+            else
+                emit onMonitorDeSelected();
+        }
+
+        emit onScreenChanged(change);
+    }
+
     // mouse signals
 signals:
-    void onMonitorSelected(Monitor* selection);
+    /// \brief Emitted when a click selects a monitor, or a drag moves a monitor that was not selected
+    void onMonitorSelected(MonitorId selection);
+    /// \brief Emitted when the selection is cleared, e.g. by a click on empty space, or when monitors are added or removed
     void onMonitorDeSelected();
-    void onMonitorMoved(Monitor* selection);
+    /// \brief Emitted once per drag frame for the dragged monitor, after onMonitorSelected() if the drag selected it
+    void onMonitorMoved(MonitorId selection);
+
+    /// \brief Emitted for every change of the shown screen, see Screen::addObserver()
+    void onScreenChanged(const ScreenChange& change);
 
     // mouse handling functions
 protected:
+    /// \brief Refit the layout to the new size
+    void resizeEvent(QResizeEvent *e) Q_DECL_OVERRIDE {
+        QWidget::resizeEvent(e);
+        if(mAutoFit)
+            fitToLayout();
+    }
+
+    /// \brief Zoom around the mouse position
+    void wheelEvent(QWheelEvent *e) Q_DECL_OVERRIDE {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        zoom(std::pow(WHEEL_ZOOM_BASE, e->angleDelta().y()), e->position().toPoint());
+#else
+        zoom(std::pow(WHEEL_ZOOM_BASE, e->angleDelta().y()), e->pos());
+#endif
+        e->accept();
+    }
+
     void mousePressEvent(QMouseEvent *e) {
+        // the middle button pans in every mode
+        if(e->button() == Qt::MiddleButton) {
+            mPanning = true;
+            mPanOrigin = e->pos();
+            return;
+        }
+
         if(mInteractionMode != InteractionMode::ConfigureMonitors)
             return;
 
-        mLastMousePosition = e->pos();
-        mClickedMonitor = mScreen->getMonitor(mLastMousePosition);
+        mLastMousePosition = e->pos() + mPan;
+        mClickedMonitor = mScreen->monitorAt(mLastMousePosition);
         mMouseMoved = false;
+
+        // a drag becomes a single history entry when it ends
+        if(const Monitor* m = mScreen->monitor(mClickedMonitor))
+            mDragStartGeometry = m->geometryFields();
     }
 
     void mouseMoveEvent(QMouseEvent *e) {
+        if(mPanning) {
+            pan(mPanOrigin - e->pos());
+            mPanOrigin = e->pos();
+            return;
+        }
+
         if(mInteractionMode != InteractionMode::ConfigureMonitors)
             return;
 
+        // keep the other monitors in the cached layer while dragging
+        if(!mMouseMoved)
+            mScreen->setVolatileMonitor(mClickedMonitor);
+
         mMouseMoved = true;
-        mScreen->moveMonitors(mClickedMonitor, e->pos(), mLastMousePosition, this->rect());
 
+        // only the latest position within a frame is snapped
+        mPendingDragPosition = e->pos() + mPan;
+        mDragPending = true;
+
+        // the first move after an idle frame is handled right away
+        if(!mDragFrameTimer->isActive())
+            commitDragFrame();
+    }
+
+private slots:
+    void applyPendingFit() {
+        mFitPending = false;
+        if(mAutoFit)
+            fitToLayout();
+    }
+
+    /**
+     * @brief Snap the dragged monitor to the latest mouse position, then sync the ui once
+     *
+     * Runs at most once per DRAG_FRAME_INTERVAL; moves arriving in between only replace the pending position.
+     */
+    void commitDragFrame() {
+        // nothing moved during the last frame, the drag is idle
+        if(!mDragPending)
+            return;
+
+        mDragPending = false;
+
+        // a drag that started on empty space moves nothing
+        if(mClickedMonitor == INVALID_MONITOR_ID)
+            return;
+
+        // moving selects the dragged monitor, screenChanged() emits onMonitorSelected() for it
+        mScreen->moveMonitors(mClickedMonitor, mPendingDragPosition, mLastMousePosition, sceneRect());
         emit onMonitorMoved(mClickedMonitor);
 
-        update();
+        updateDirtyRegion();
+
+        // coalesce the moves of the next frame
+        mDragFrameTimer->start();
     }
 
+protected:
+
     /**
      * @brief Save the last mouse position, reset clicked monitor, and possibly select a monitor
      */
     void mouseReleaseEvent(QMouseEvent *e) {
+        if(e->button() == Qt::MiddleButton) {
+            mPanning = false;
+            return;
+        }
+
+        // apply the last coalesced move before the drag ends
+        commitDragFrame();
+        mDragFrameTimer->stop();
+
         // save the last mouseposition
-        mLastMousePosition = e->pos();
+        mLastMousePosition = e->pos() + mPan;
+
+        // record the whole drag as one change
+        if(mMouseMoved)
+            if(const Monitor* m = mScreen->monitor(mClickedMonitor))
+                recordGeometryChange(mClickedMonitor, mDragStartGeometry, m->geometryFields());
 
         // a monitor is no longer clicked
-        mClickedMonitor = nullptr;
+        mClickedMonitor = INVALID_MONITOR_ID;
+
+        // the dragged monitor becomes part of the cached layer again
+        if(mScreen->volatileMonitor() != INVALID_MONITOR_ID) {
+            mScreen->setVolatileMonitor(INVALID_MONITOR_ID);
+            update();
+        }
 
         // if the mouse did not move, this was a click event
         if(!mMouseMoved) {
-            handleClick(e->pos());
+            handleClick(mLastMousePosition);
         }
     }
 
     void handleClick(const QPoint& position) {
         if(mInteractionMode == InteractionMode::ConfigureMonitors) {
             // get clicked monitor
-            Monitor* selected = mScreen->getMonitor(position);
+            const Monitor* selected = mScreen->getMonitor(position);
 
-            if(!selected){
+            // screenChanged() emits onMonitorSelected() or onMonitorDeSelected()
+            if(!selected)
                 mScreen->deselectCurrent();
-                emit onMonitorDeSelected();
-            } else {
-                // select clicked monitor
-                bool selectionState =
-                        mScreen->toggleSingleMonitorSelection(selected->getName());
-
-                if(selectionState)
-                    emit onMonitorSelected(selected);
-                else
-                    emit onMonitorDeSelected();
-            }
+            else
+                mScreen->toggleSingleMonitorSelection(selected->getName());
         } else {
             // get clicked border
-            QString selMonitor;
-            int selBorderIndex;
-            const Border* selBorder = mScreen->getBorder(position, selMonitor, selBorderIndex);
+            const BorderHandle selBorder = mScreen->borderAt(position);
 
             // nothing clicked
-            if(selBorderIndex < 0 || selMonitor == "")
+            if(!selBorder.isValid())
                 return;
 
             QColor selectionColor;
@@ -700,35 +2845,193 @@ protected:
                 assert(false && "unknown enum element");
             }
 
-            // select clicked monitor
-            if(selBorder->drawColor != selectionColor) {
-                mScreen->selectBorder(selMonitor, selBorderIndex, selectionColor);
-                mBorders[selBorderIndex].push_back(selBorder);
-            }
-            // unselect if the monitor was already selected
-            else {
-                mScreen->selectBorder(selMonitor, selBorderIndex, Qt::GlobalColor::lightGray);
-                mBorders[selBorderIndex].removeAll(selBorder);
-            }
+            // select clicked border, or unselect it if it was already selected
+            const History::BorderState before = History::BorderState::capture(*mScreen, selBorder);
+            mScreen->toggleBorderSelection(selBorder, selectionColor);
+            mHistory->push(new History::BorderCommand(mScreen, mScreen->monitor(selBorder.monitor)->getName(), selBorder.border,
+                                                      before, History::BorderState::capture(*mScreen, selBorder)));
         }
         // update screen
-        update();
+        updateDirtyRegion();
     }
 
     // mouse handling members
 private:
     bool mMouseMoved = false;///< true if the mouse was moved since the last click
-    Monitor* mClickedMonitor;///< last clicked monitor
+    MonitorId mClickedMonitor = INVALID_MONITOR_ID;///< last clicked monitor
     QPoint mLastMousePosition;
 
+    static const int DRAG_FRAME_INTERVAL = 16;///< minimum time between two drag steps in ms, one frame at 60 Hz
+    QTimer* mDragFrameTimer;///< running while moves are being coalesced into the current frame
+    QPoint mPendingDragPosition;///< latest mouse position not yet applied to the dragged monitor
+    bool mDragPending = false;///< true if mPendingDragPosition still has to be applied
+    GeometryUpdate mDragStartGeometry;///< geometry of the clicked monitor when the mouse was pressed
+
+    // zoom and pan members
+private:
+    static constexpr double MIN_SCALE = 1.0 / 1000.0;///< smallest zoom, desktop to widget pixels
+    static constexpr double MAX_SCALE = 1.0;///< largest zoom, desktop to widget pixels
+    static constexpr double WHEEL_ZOOM_BASE = 1.0015;///< zoom factor per wheel angle unit, 1/8 degree
+    static const int FIT_MARGIN = 8;///< free widget pixels around the layout when it is fitted
+    QPoint mPan;///< scaled screen position shown at the top left of the widget
+    bool mAutoFit = true;///< fit the layout into the widget on resize, add and delete
+    bool mFitPending = false;///< a fit is scheduled for when control returns to the event loop
+    bool mPanning = false;///< true while the middle button is held
+    QPoint mPanOrigin;///< widget position of the last pan step
+
+    // history members
+private:
+    static const int DEFAULT_UNDO_LIMIT = 1000;///< history entries kept; each stores only changed fields
+    QUndoStack* mHistory;///< undo history of all edits
+
     // general members
 private:
     InteractionMode mInteractionMode = InteractionMode::ConfigureMonitors;
     Screen* mScreen;
 
-    // result members
+    // retained rendering members
+private:
+    QPixmap mStaticLayer;///< all monitors except the volatile one, drawn with the current mode
+    quint64 mStaticLayerGeneration = 0;///< Screen::staticGeneration() mStaticLayer was drawn at
+    InteractionMode mStaticLayerMode = InteractionMode::First_INVALID;///< interaction mode mStaticLayer was drawn in
+    QPoint mStaticLayerPan;///< pan position mStaticLayer was drawn at
+};
+
+
+
+
+
+/*
+ *
+ *
+ *
+ *
+ * *************************************************************************************************************************************************
+ * FORM BINDING
+ * *************************************************************************************************************************************************
+ *
+ *
+ *
+ *
+ */
+/**
+ * @brief Keeps the geometry fields of one monitor and a set of line edits in sync
+ *
+ * Monitor changes are pulled into the line edits with their signals blocked, and only fields whose
+ * value differs from what is shown are rewritten. An edit is pushed to the monitor as an update of
+ * that single field. Neither direction echoes back into the other.
+ */
+class MonitorFormBinding : public QObject {
+    Q_OBJECT
+
+public:
+    MonitorFormBinding(ScreenDisplayWidget* display, QObject* parent = 0) : QObject(parent), mDisplay(display) {
+    }
+
+    /// \brief Show the name of the bound monitor in edit
+    void bindName(QLineEdit* edit) {
+        mNameEdit = edit;
+    }
+
+    /// \brief Keep edit and a geometry field of the bound monitor in sync
+    void bind(QLineEdit* edit, GeometryUpdate::Field field) {
+        mFields.append(BoundField(edit, field));
+        connect(edit, SIGNAL(textChanged(QString)), this, SLOT(onFieldEdited()));
+    }
+
+    /// \brief Bind to another monitor, or to none with INVALID_MONITOR_ID
+    void setMonitor(MonitorId id) {
+        mMonitor = id;
+        mShown = GeometryUpdate();
+        pull();
+    }
+
+    MonitorId monitor() const {
+        return mMonitor;
+    }
+
+public slots:
+    /// \brief Follow changes of the bound monitor, e.g. by dragging, undo and redo
+    void screenChanged(const ScreenChange& change) {
+        if(change.monitor != mMonitor)
+            return;
+
+        if(change.type == ScreenChange::MonitorRemoved)
+            setMonitor(INVALID_MONITOR_ID);
+        else
+            pull();
+    }
+
+    /// \brief Write all fields that differ from what is shown to the line edits
+    void pull() {
+        const Monitor* mon = mDisplay->monitor(mMonitor);
+        if(!mon)
+            return;
+
+        if(mNameEdit && mShown.fields == 0) {
+            QSignalBlocker blocker(mNameEdit);
+            mNameEdit->setText(mon->getName());
+        }
+
+        const GeometryUpdate current = mon->geometryFields();
+        for(const BoundField& bound : mFields) {
+            const Coordinate value = current.value(bound.field);
+            if(mShown.contains(bound.field) && mShown.value(bound.field) == value)
+                continue;
+
+            QSignalBlocker blocker(bound.edit);
+            bound.edit->setText(QString::number(value));
+            mShown.set(bound.field, value);
+        }
+    }
+
+private slots:
+    /// \brief Push the edited field, and only that one, to the monitor
+    void onFieldEdited() {
+        Monitor* mon = mDisplay->monitor(mMonitor);
+        if(!mon)
+            return;
+
+        for(const BoundField& bound : mFields) {
+            if(bound.edit != sender())
+                continue;
+
+            bool ok = false;
+            const int value = bound.edit->text().toInt(&ok);
+            GeometryUpdate edited = mon->geometryFields();
+            edited.set(bound.field, value);
+
+            // incomplete or invalid input: rewrite this field on the next pull
+            if(!ok || !Monitor::isValidGeometry(edited)) {
+                mShown.fields &= ~bound.field;
+                return;
+            }
+
+            mShown.set(bound.field, value);
+            const GeometryUpdate before = mon->geometryFields();
+            if(mon->apply(GeometryUpdate().set(bound.field, value))) {
+                // typing into one field becomes a single history entry
+                mDisplay->recordGeometryChange(mMonitor, before, mon->geometryFields(), bound.field);
+                mDisplay->updateDirtyRegion();
+            }
+            return;
+        }
+    }
+
 private:
-    QVector<const Border *> mBorders[4];
+    /// \brief A line edit bound to a geometry field
+    struct BoundField {
+        BoundField(QLineEdit* e = nullptr, GeometryUpdate::Field f = GeometryUpdate::Width) : edit(e), field(f) {}
+
+        QLineEdit* edit;///< the line edit showing the field
+        GeometryUpdate::Field field;///< the field shown
+    };
+
+    ScreenDisplayWidget* mDisplay;///< widget owning the monitors
+    MonitorId mMonitor = INVALID_MONITOR_ID;///< the bound monitor
+    QLineEdit* mNameEdit = nullptr;///< line edit showing the name of the bound monitor
+    QVector<BoundField> mFields;///< line edits bound to geometry fields
+    GeometryUpdate mShown;///< the field values currently shown in the line edits
 };
 
 
@@ -838,7 +3141,7 @@ private:
     QLineEdit* mHorLetterboxInput; ///< horizontal letterboxing input
     QLineEdit* mVerLetterBoxInput; ///< vertical letterboxing input
     QWidget* mMonitorConfigurationWidget;
-    Monitor* mLastSelectedMonitor = nullptr;
+    MonitorFormBinding* mFormBinding; ///< syncs the line edits with the selected monitor
 
     // slots for handling monitor configuration
 private slots:
@@ -848,42 +3151,15 @@ private slots:
         mAddButton->setEnabled(true);
         mDeleteButton->setEnabled(false);
 
-        mLastSelectedMonitor = nullptr;
+        mFormBinding->setMonitor(INVALID_MONITOR_ID);
     }
 
-    void onMonitorSelected(Monitor* selection){
+    void onMonitorSelected(MonitorId selection){
         // if a monitor is selected, the add button will be disabled, vice versa with remove button
         mAddButton->setEnabled(false);
         mDeleteButton->setEnabled(true);
 
-        mLastSelectedMonitor = selection;
-
-        readMonitorConfigToUi(mLastSelectedMonitor);
-    }
-
-    void readMonitorConfigToUi(Monitor* mon){
-        if(!mon)
-            return;
-
-        mNameInput->setText(mon->getName());
-        mHorizontalResolutionInput->setText(QString::number(mon->width()));
-        mVerticalResolutionInput->setText(QString::number(mon->height()));
-        mXOffInput->setText(QString::number(mon->xOffset()));
-        mYOffInput->setText(QString::number(mon->yOffset()));
-        mHorLetterboxInput->setText(QString::number(mon->horizontalLetterboxBarHeight()));
-        mVerLetterBoxInput->setText(QString::number(mon->verticalLetterboxBarWidth()));
-    }
-
-    void updateCurrentMonitor(){
-        if(!mLastSelectedMonitor)
-            return;
-
-        mLastSelectedMonitor->setWidth(mHorizontalResolutionInput->text().toInt());
-        mLastSelectedMonitor->setHeight(mVerticalResolutionInput->text().toInt());
-        mLastSelectedMonitor->setXOffset(mXOffInput->text().toInt());
-        mLastSelectedMonitor->setYOffset(mYOffInput->text().toInt());
-        mLastSelectedMonitor->setHorizontalLetterboxBarHeight(mHorLetterboxInput->text().toInt());
-        mLastSelectedMonitor->setVerticalLetterboxBarWidth(mVerLetterBoxInput->text().toInt());
+        mFormBinding->setMonitor(selection);
     }
 
     void onAddButton() {
@@ -895,10 +3171,16 @@ private slots:
         int horLetterbox = mHorLetterboxInput->text().toInt();
         int verLetterbox = mVerLetterBoxInput->text().toInt();
 
-        // only allow monitors with non-zero area
-        if(horRes == 0 || verRes == 0)
+        // only allow monitors with non-zero area; offsets may be negative
+        if(horRes <= 0 || verRes <= 0)
             return;
 
+        if(!Monitor::isValidGeometry(GeometryUpdate().setWidth(horRes).setHeight(verRes).setXOffset(xOff).setYOffset(yOff)
+                                     .setVerticalLetterboxBarWidth(horLetterbox).setHorizontalLetterboxBarHeight(verLetterbox))) {
+            QMessageBox::warning(this->parentWidget(), "Invalid geometry", "Letterbox bars must not be negative, and the monitor must end within the coordinate range", QMessageBox::Ok);
+            return;
+        }
+
         bool added = mDisplayWidget->addMonitor(
                          mNameInput->text(),
                          horRes, verRes,
@@ -941,17 +3223,18 @@ private:
         connect(mPrevModeButton, SIGNAL(clicked()), this, SLOT(onPrevModeButton()));
 
         // when the monitor changes, update the ui
-        connect(mDisplayWidget, SIGNAL(onMonitorSelected(Monitor*)), this, SLOT(onMonitorSelected(Monitor*)));
+        connect(mDisplayWidget, SIGNAL(onMonitorSelected(MonitorId)), this, SLOT(onMonitorSelected(MonitorId)));
         connect(mDisplayWidget, SIGNAL(onMonitorDeSelected()), this, SLOT(onMonitorDeselected()));
-        connect(mDisplayWidget, SIGNAL(onMonitorMoved(Monitor*)), this, SLOT(readMonitorConfigToUi(Monitor*)));
+        connect(mDisplayWidget, SIGNAL(onScreenChanged(ScreenChange)), mFormBinding, SLOT(screenChanged(ScreenChange)));
 
         // when the ui changes, update the monitor
-        connect(mHorizontalResolutionInput, SIGNAL(textChanged(QString)), this, SLOT(updateCurrentMonitor()));
-        connect(mVerticalResolutionInput, SIGNAL(textChanged(QString)), this, SLOT(updateCurrentMonitor()));
-        connect(mXOffInput, SIGNAL(textChanged(QString)), this, SLOT(updateCurrentMonitor()));
-        connect(mYOffInput, SIGNAL(textChanged(QString)), this, SLOT(updateCurrentMonitor()));
-        connect(mHorLetterboxInput, SIGNAL(textChanged(QString)), this, SLOT(updateCurrentMonitor()));
-        connect(mVerLetterBoxInput, SIGNAL(textChanged(QString)), this, SLOT(updateCurrentMonitor()));
+        mFormBinding->bindName(mNameInput);
+        mFormBinding->bind(mHorizontalResolutionInput, GeometryUpdate::Width);
+        mFormBinding->bind(mVerticalResolutionInput, GeometryUpdate::Height);
+        mFormBinding->bind(mXOffInput, GeometryUpdate::XOffset);
+        mFormBinding->bind(mYOffInput, GeometryUpdate::YOffset);
+        mFormBinding->bind(mHorLetterboxInput, GeometryUpdate::HorizontalLetterboxBarHeight);
+        mFormBinding->bind(mVerLetterBoxInput, GeometryUpdate::VerticalLetterboxBarWidth);
     }
 
     void layoutMonitorConfig() {
@@ -1008,6 +3291,9 @@ private:
         mDisplayWidget = new ScreenDisplayWidget(this->parentWidget());
         controlLayout->addWidget(mDisplayWidget);
 
+        // keeps the monitor configuration inputs in sync with the selected monitor
+        mFormBinding = new MonitorFormBinding(mDisplayWidget, this);
+
         mExplanationLabel = new QLabel(this);
         mExplanationLabel->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Fixed);
         controlLayout->addWidget(mExplanationLabel);
@@ -0,0 +1,224 @@
+#ifndef SCREENSNAPSHOT_H
+#define SCREENSNAPSHOT_H
+
+#include "screenconfiglayout.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace ScreenConfigWidget {
+
+/**
+ * @brief The configuration of one monitor at the time a snapshot was taken
+ */
+struct MonitorSnapshot {
+    MonitorId id = INVALID_MONITOR_ID;///< id of the monitor
+    QString name;///< monitor name
+    Geometry geometry;///< monitor size and offset in pixels
+    Coordinate verticalLetterboxBarWidth = 0;///< width of the vertical letterbox bars
+    Coordinate horizontalLetterboxBarHeight = 0;///< height of the horizontal letterbox bars
+    Border borders[4];///< border geometry and color, indexed by BorderIndex
+};
+
+/**
+ * @brief An immutable copy of the screen configuration, safe to read from any thread
+ */
+struct ScreenSnapshot {
+    quint64 version = 0;///< Screen::layoutGeneration() the snapshot was taken at
+    std::vector<MonitorSnapshot> monitors;///< all monitors, in the order they were added
+    std::vector<BorderHandle> selectedHandles[4];///< selected borders per BorderIndex, in selection order
+    std::vector<Border> selectedBorders[4];///< copies of the selected borders, parallel to selectedHandles
+
+    /// \brief Take a snapshot of screen
+    explicit ScreenSnapshot(const Screen& screen) : version(screen.layoutGeneration()) {
+        monitors.reserve(screen.monitors().size());
+        for(const Monitor& m : screen.monitors()) {
+            MonitorSnapshot s;
+            s.id = m.id();
+            s.name = m.getName();
+            s.geometry = Geometry(m.width(), m.height(), m.xOffset(), m.yOffset());
+            s.verticalLetterboxBarWidth = m.verticalLetterboxBarWidth();
+            s.horizontalLetterboxBarHeight = m.horizontalLetterboxBarHeight();
+            for(int b = 0; b < 4; b++)
+                s.borders[b] = m[BorderIndex(b)];
+            monitors.push_back(s);
+        }
+
+        for(int i = 0; i < 4; i++) {
+            const BorderView view = screen.selectedBorderView(BorderIndex(i));
+            const QVector<BorderHandle>& handles = screen.selectedBorders(BorderIndex(i));
+            selectedHandles[i].assign(handles.begin(), handles.end());
+            selectedBorders[i].assign(view.begin(), view.end());
+        }
+    }
+};
+
+/**
+ * @brief Hands immutable screen snapshots from the GUI thread to worker threads
+ *
+ * The GUI thread calls publish() after edits; this never waits for readers. Readers pin the
+ * current snapshot through a SnapshotReader without locking, and keep it until they release it,
+ * so they never see a half applied edit.
+ *
+ * Replaced snapshots are freed by publish() once no reader can still hold them: every pinning
+ * reader announces the publish epoch it started in, and a snapshot retired in epoch E is only
+ * deleted when no reader announces an epoch up to E.
+ */
+class SnapshotPublisher {
+public:
+    static const int MAX_READERS = 32;///< maximum number of concurrently registered readers
+
+    SnapshotPublisher() {
+        for(int i = 0; i < MAX_READERS; i++) {
+            mReaderUsed[i].store(false);
+            mReaderEpochs[i].store(IDLE);
+        }
+    }
+
+    /// \brief All readers must be destroyed before the publisher
+    ~SnapshotPublisher() {
+        delete mCurrent.load();
+        for(const Retired& r : mRetired)
+            delete r.snapshot;
+    }
+
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    /**
+     * @brief Publish the current configuration of screen; GUI thread only
+     *
+     * Does nothing if the configuration did not change since the last publish().
+     * @return true if a new snapshot was published
+     */
+    bool publish(const Screen& screen) {
+        const ScreenSnapshot* current = mCurrent.load();
+        if(current && current->version == screen.layoutGeneration()) {
+            reclaim();
+            return false;
+        }
+
+        const ScreenSnapshot* previous = mCurrent.exchange(new ScreenSnapshot(screen));
+        const quint64 retiredIn = mEpoch.fetch_add(1);
+        if(previous)
+            mRetired.push_back(Retired{previous, retiredIn});
+
+        reclaim();
+        return true;
+    }
+
+    /// \brief Version of the latest published snapshot, 0 if there is none
+    quint64 version() const {
+        const ScreenSnapshot* current = mCurrent.load();
+        return current ? current->version : 0;
+    }
+
+    /// \brief Number of replaced snapshots not yet freed, e.g. because a reader still holds them
+    int retiredCount() const {
+        return int(mRetired.size());
+    }
+
+private:
+    friend class SnapshotReader;
+
+    static const quint64 IDLE = std::numeric_limits<quint64>::max();///< epoch of a reader holding no snapshot
+
+    /// \brief A replaced snapshot, with the epoch it was replaced in
+    struct Retired {
+        const ScreenSnapshot* snapshot;
+        quint64 epoch;
+    };
+
+    int registerReader() {
+        for(int i = 0; i < MAX_READERS; i++) {
+            bool expected = false;
+            if(mReaderUsed[i].compare_exchange_strong(expected, true))
+                return i;
+        }
+        throw std::runtime_error("too many snapshot readers");
+    }
+
+    void unregisterReader(int slot) {
+        unpin(slot);
+        mReaderUsed[slot].store(false);
+    }
+
+    const ScreenSnapshot* pin(int slot) {
+        // announce the epoch before loading the pointer, so publish() sees either the announcement
+        // or the reader sees the new snapshot
+        mReaderEpochs[slot].store(mEpoch.load());
+        return mCurrent.load();
+    }
+
+    void unpin(int slot) {
+        mReaderEpochs[slot].store(IDLE);
+    }
+
+    /// \brief Free all retired snapshots no reader can hold anymore
+    void reclaim() {
+        if(mRetired.empty())
+            return;
+
+        quint64 oldest = IDLE;
+        for(int i = 0; i < MAX_READERS; i++)
+            oldest = std::min(oldest, mReaderEpochs[i].load());
+
+        mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(), [oldest](const Retired& r) {
+            if(r.epoch < oldest) {
+                delete r.snapshot;
+                return true;
+            }
+            return false;
+        }), mRetired.end());
+    }
+
+    std::atomic<const ScreenSnapshot*> mCurrent{nullptr};///< latest published snapshot
+    std::atomic<quint64> mEpoch{0};///< number of snapshots replaced so far
+    std::atomic<bool> mReaderUsed[MAX_READERS];///< registered reader slots
+    std::atomic<quint64> mReaderEpochs[MAX_READERS];///< epoch announced by each pinning reader, or IDLE
+    std::vector<Retired> mRetired;///< replaced snapshots, GUI thread only
+};
+
+/**
+ * @brief Reads snapshots of a SnapshotPublisher on one worker thread
+ *
+ * Usage per frame: acquire() the snapshot, process the frame, release() it.
+ */
+class SnapshotReader {
+public:
+    explicit SnapshotReader(SnapshotPublisher& publisher) :
+        mPublisher(publisher), mSlot(publisher.registerReader()) {
+    }
+
+    ~SnapshotReader() {
+        mPublisher.unregisterReader(mSlot);
+    }
+
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    /**
+     * @brief Pin the latest snapshot, releasing the previous one
+     * @return the snapshot, valid until release(); nullptr if nothing was published yet
+     */
+    const ScreenSnapshot* acquire() {
+        release();
+        return mPublisher.pin(mSlot);
+    }
+
+    /// \brief Allow the publisher to free the acquired snapshot
+    void release() {
+        mPublisher.unpin(mSlot);
+    }
+
+private:
+    SnapshotPublisher& mPublisher;
+    const int mSlot;
+};
+
+}
+
+#endif // SCREENSNAPSHOT_H